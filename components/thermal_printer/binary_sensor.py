@@ -0,0 +1,40 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import binary_sensor
+from esphome.const import DEVICE_CLASS_PROBLEM
+from .display import ThermalPrinterDisplay
+from .sensor import CONF_THERMAL_PRINTER_ID
+
+# Reported by the printer in answer to status polls, see the printer's status_interval option
+CONF_PAPER_OUT = "paper_out"
+CONF_PAPER_NEAR_END = "paper_near_end"
+CONF_COVER_OPEN = "cover_open"
+CONF_OVERHEATED = "overheated"
+
+BINARY_SENSORS = {
+    CONF_PAPER_OUT: "mdi:paper-roll-outline",
+    CONF_PAPER_NEAR_END: "mdi:paper-roll",
+    CONF_COVER_OPEN: "mdi:printer-alert",
+    CONF_OVERHEATED: "mdi:thermometer-alert",
+}
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(CONF_THERMAL_PRINTER_ID): cv.use_id(ThermalPrinterDisplay),
+        **{
+            cv.Optional(key): binary_sensor.binary_sensor_schema(
+                device_class=DEVICE_CLASS_PROBLEM,
+                icon=icon,
+            )
+            for key, icon in BINARY_SENSORS.items()
+        },
+    }
+)
+
+
+async def to_code(config):
+    printer = await cg.get_variable(config[CONF_THERMAL_PRINTER_ID])
+    for key in BINARY_SENSORS:
+        if key in config:
+            sens = await binary_sensor.new_binary_sensor(config[key])
+            cg.add(getattr(printer, f"set_{key}_binary_sensor")(sens))
@@ -1,48 +1,276 @@
 import esphome.config_validation as cv
 import esphome.codegen as cg
-from esphome.components import display, uart
-from esphome.const import CONF_HEIGHT, CONF_ID, CONF_LAMBDA
-from esphome import automation
+import esphome.final_validate as fv
+from esphome.components import display, font, image, uart
+from esphome.const import (
+    CONF_DATA,
+    CONF_HEIGHT,
+    CONF_ID,
+    CONF_IMAGE,
+    CONF_LAMBDA,
+    CONF_PLATFORM,
+    CONF_ROTATION,
+    CONF_TRIGGER_ID,
+    CONF_TYPE,
+)
+from esphome import automation, pins
 
 DEPENDENCIES = ["uart"]
+AUTO_LOAD = ["image"]
 
 thermal_printer_ns = cg.esphome_ns.namespace("thermal_printer")
 
 ThermalPrinterDisplay = thermal_printer_ns.class_(
     "ThermalPrinterDisplay", display.DisplayBuffer, uart.UARTDevice
 )
+ThermalPrinterDisplayRef = ThermalPrinterDisplay.operator("ref")
 
 ThermalPrinterPrintTextAction = thermal_printer_ns.class_(
     "ThermalPrinterPrintTextAction", automation.Action
 )
+ThermalPrinterPrintPageAction = thermal_printer_ns.class_(
+    "ThermalPrinterPrintPageAction", automation.Action
+)
+ThermalPrinterFeedAction = thermal_printer_ns.class_(
+    "ThermalPrinterFeedAction", automation.Action
+)
+ThermalPrinterCancelAction = thermal_printer_ns.class_(
+    "ThermalPrinterCancelAction", automation.Action
+)
+ThermalPrinterPrintQRCodeAction = thermal_printer_ns.class_(
+    "ThermalPrinterPrintQRCodeAction", automation.Action
+)
+ThermalPrinterPrintBarcodeAction = thermal_printer_ns.class_(
+    "ThermalPrinterPrintBarcodeAction", automation.Action
+)
+ThermalPrinterPrintImageAction = thermal_printer_ns.class_(
+    "ThermalPrinterPrintImageAction", automation.Action
+)
+ThermalPrinterPrintReceiptAction = thermal_printer_ns.class_(
+    "ThermalPrinterPrintReceiptAction", automation.Action
+)
+ThermalPrinterPrintTimingTestAction = thermal_printer_ns.class_(
+    "ThermalPrinterPrintTimingTestAction", automation.Action
+)
+ThermalPrinterCalibrateTimingAction = thermal_printer_ns.class_(
+    "ThermalPrinterCalibrateTimingAction", automation.Action
+)
+ThermalPrinterSetTimingAction = thermal_printer_ns.class_(
+    "ThermalPrinterSetTimingAction", automation.Action
+)
+
+BarcodeType = thermal_printer_ns.enum("BarcodeType")
+BARCODE_TYPES = {
+    "UPC_A": BarcodeType.UPC_A,
+    "UPC_E": BarcodeType.UPC_E,
+    "EAN13": BarcodeType.EAN13,
+    "EAN8": BarcodeType.EAN8,
+    "CODE39": BarcodeType.CODE39,
+    "ITF": BarcodeType.ITF,
+    "CODABAR": BarcodeType.CODABAR,
+    "CODE93": BarcodeType.CODE93,
+    "CODE128": BarcodeType.CODE128,
+}
+
+DitherMode = thermal_printer_ns.enum("DitherMode")
+DITHER_MODES = {
+    "THRESHOLD": DitherMode.DITHER_THRESHOLD,
+    "FLOYD_STEINBERG": DitherMode.DITHER_FLOYD_STEINBERG,
+    "BAYER": DitherMode.DITHER_BAYER,
+}
+
+# ReceiptStyle bits
+CONF_BOLD = "bold"
+CONF_DOUBLE_HEIGHT = "double_height"
+CONF_DOUBLE_WIDTH = "double_width"
+CONF_UNDERLINE = "underline"
+RECEIPT_STYLES = {
+    CONF_BOLD: 1 << 3,
+    CONF_DOUBLE_HEIGHT: 1 << 4,
+    CONF_DOUBLE_WIDTH: 1 << 5,
+    CONF_UNDERLINE: 1 << 7,
+}
+RECEIPT_ALIGNS = {
+    "LEFT": "L",
+    "CENTER": "C",
+    "RIGHT": "R",
+}
+
+JobCompleteTrigger = thermal_printer_ns.class_(
+    "JobCompleteTrigger", automation.Trigger.template()
+)
+QueueEmptyTrigger = thermal_printer_ns.class_(
+    "QueueEmptyTrigger", automation.Trigger.template()
+)
 
 CONF_FONT_SIZE = "font_size"
 CONF_TEXT = "text"
+CONF_BAND_HEIGHT = "band_height"
+CONF_MAX_LOOP_TIME = "max_loop_time"
+CONF_TX_BUFFER_SIZE = "tx_buffer_size"
+CONF_DOUBLE_BUFFER = "double_buffer"
+CONF_MAX_CHUNK_HEIGHT = "max_chunk_height"
+CONF_DTR_PIN = "dtr_pin"
+CONF_STATUS_INTERVAL = "status_interval"
+CONF_UPGRADE_BAUD_RATE = "upgrade_baud_rate"
+CONF_JOB_QUEUE_SIZE = "job_queue_size"
+CONF_ON_JOB_COMPLETE = "on_job_complete"
+CONF_ON_QUEUE_EMPTY = "on_queue_empty"
+CONF_PRIORITY = "priority"
+CONF_LINES = "lines"
+CONF_FIRMWARE = "firmware"
+CONF_QR_MODULE_SIZE = "qr_module_size"
+CONF_DITHER = "dither"
+CONF_CODE_PAGE = "code_page"
+CONF_RECEIPT_FONT = "receipt_font"
+CONF_ALIGN = "align"
+CONF_PAPER_WIDTH = "paper_width"
+CONF_BANNER = "banner"
+CONF_ROW_TIME = "row_time"
+CONF_HEAT_SCALE = "heat_scale"
+
+
+def _validate_double_buffer(config):
+    if config[CONF_DOUBLE_BUFFER] and CONF_BAND_HEIGHT in config:
+        raise cv.Invalid(
+            f"{CONF_DOUBLE_BUFFER} needs full-page mode, it can't be combined with {CONF_BAND_HEIGHT}"
+        )
+    return config
+
 
-CONFIG_SCHEMA = (
+def _validate_banner(config):
+    if config[CONF_BANNER] and config.get(CONF_ROTATION, 0) not in (0, 90):
+        raise cv.Invalid(
+            f"{CONF_BANNER} prints rotated by 90 degrees, it can't be combined with another {CONF_ROTATION}"
+        )
+    return config
+
+
+CONFIG_SCHEMA = cv.All(
     display.FULL_DISPLAY_SCHEMA.extend(
         {
             cv.GenerateID(): cv.declare_id(ThermalPrinterDisplay),
             cv.Required(CONF_HEIGHT): cv.uint16_t,
+            # Printable dots per row: 384 for 58mm paper, 576 for 80mm paper
+            cv.Optional(CONF_PAPER_WIDTH, default=384): cv.one_of(384, 576, int=True),
+            cv.Optional(CONF_BAND_HEIGHT): cv.int_range(min=1, max=65535),
+            cv.Optional(CONF_DOUBLE_BUFFER, default=False): cv.boolean,
+            # Lambda draws across the paper: width is height, height is paper_width
+            cv.Optional(CONF_BANNER, default=False): cv.boolean,
+            cv.Optional(
+                CONF_MAX_LOOP_TIME, default="20ms"
+            ): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_TX_BUFFER_SIZE, default=1024): cv.int_range(
+                min=64, max=65535
+            ),
+            cv.Optional(CONF_MAX_CHUNK_HEIGHT, default=255): cv.int_range(
+                min=1, max=255
+            ),
+            cv.Optional(CONF_DTR_PIN): pins.internal_gpio_input_pin_schema,
+            # Needs the printer's TX wired to the UART's rx_pin
+            cv.Optional(CONF_STATUS_INTERVAL): cv.positive_time_period_milliseconds,
+            # Also needs rx_pin, see _final_validate()
+            cv.Optional(CONF_UPGRADE_BAUD_RATE): cv.one_of(
+                19200, 38400, 57600, 115200, int=True
+            ),
+            cv.Optional(CONF_JOB_QUEUE_SIZE, default=16): cv.int_range(
+                min=1, max=255
+            ),
+            cv.Optional(CONF_FIRMWARE, default=268): cv.int_range(min=100, max=999),
+            cv.Optional(CONF_QR_MODULE_SIZE, default=4): cv.int_range(min=1, max=16),
+            # ESC t code page receipts are encoded in, see setCodePage()
+            cv.Optional(CONF_CODE_PAGE, default=0): cv.int_range(min=0, max=47),
+            # Prints receipt lines the code page can't encode
+            cv.Optional(CONF_RECEIPT_FONT): cv.use_id(font.Font),
+            # Raster timing coefficients, see set_timing_coefficients(). Given here they replace
+            # the ones saved by thermal_printer.set_timing or calibrate_timing at boot.
+            cv.Inclusive(CONF_ROW_TIME, "timing"): cv.positive_time_period_microseconds,
+            cv.Inclusive(CONF_HEAT_SCALE, "timing"): cv.int_range(min=1, max=1000),
+            cv.Optional(CONF_ON_JOB_COMPLETE): automation.validate_automation(
+                {
+                    cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(JobCompleteTrigger),
+                }
+            ),
+            cv.Optional(CONF_ON_QUEUE_EMPTY): automation.validate_automation(
+                {
+                    cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(QueueEmptyTrigger),
+                }
+            ),
         }
     )
     .extend(
         cv.polling_component_schema("never")
     )  # This component should always be manually updated with actions
-    .extend(uart.UART_DEVICE_SCHEMA)
+    .extend(uart.UART_DEVICE_SCHEMA),
+    _validate_double_buffer,
+    _validate_banner,
 )
 
 
+def _final_validate(config):
+    if CONF_UPGRADE_BAUD_RATE in config:
+        # Without the printer's answer a failed switch can't be detected and undone
+        uart.final_validate_device_schema("thermal_printer", require_rx=True)(config)
+    # paper_width becomes a global define, so every printer has to share it
+    widths = {
+        conf[CONF_PAPER_WIDTH]
+        for conf in fv.full_config.get().get("display", [])
+        if conf.get(CONF_PLATFORM) == "thermal_printer"
+    }
+    if len(widths) > 1:
+        raise cv.Invalid(
+            f"All thermal printers must use the same {CONF_PAPER_WIDTH}, got {sorted(widths)}",
+            path=[CONF_PAPER_WIDTH],
+        )
+    return config
+
+
+FINAL_VALIDATE_SCHEMA = _final_validate
+
+
 async def to_code(config):
     var = cg.new_Pvariable(config[CONF_ID])
     await display.register_display(var, config)
     await uart.register_uart_device(var, config)
 
+    # A define rather than a setter so the row stride is a compile-time constant
+    cg.add_define("THERMAL_PRINTER_PAPER_WIDTH", config[CONF_PAPER_WIDTH])
     cg.add(var.set_height(config[CONF_HEIGHT]))
+    if CONF_BAND_HEIGHT in config:
+        cg.add(var.set_band_height(config[CONF_BAND_HEIGHT]))
+    cg.add(var.set_max_loop_time(config[CONF_MAX_LOOP_TIME]))
+    cg.add(var.set_tx_buffer_size(config[CONF_TX_BUFFER_SIZE]))
+    cg.add(var.set_double_buffer(config[CONF_DOUBLE_BUFFER]))
+    cg.add(var.set_banner(config[CONF_BANNER]))
+    cg.add(var.set_max_chunk_height(config[CONF_MAX_CHUNK_HEIGHT]))
+    if CONF_DTR_PIN in config:
+        dtr_pin = await cg.gpio_pin_expression(config[CONF_DTR_PIN])
+        cg.add(var.set_dtr_pin(dtr_pin))
+    if CONF_STATUS_INTERVAL in config:
+        cg.add(var.set_status_interval(config[CONF_STATUS_INTERVAL]))
+    if CONF_UPGRADE_BAUD_RATE in config:
+        cg.add(var.set_upgrade_baud_rate(config[CONF_UPGRADE_BAUD_RATE]))
+    cg.add(var.set_job_queue_size(config[CONF_JOB_QUEUE_SIZE]))
+    cg.add(var.set_firmware(config[CONF_FIRMWARE]))
+    cg.add(var.set_qr_module_size(config[CONF_QR_MODULE_SIZE]))
+    cg.add(var.set_code_page(config[CONF_CODE_PAGE]))
+    if CONF_RECEIPT_FONT in config:
+        receipt_font = await cg.get_variable(config[CONF_RECEIPT_FONT])
+        cg.add(var.set_receipt_font(receipt_font))
+    if CONF_ROW_TIME in config:
+        cg.add(var.set_config_timing(config[CONF_ROW_TIME], config[CONF_HEAT_SCALE]))
+    # QR codes are encoded on the device for printers without native support
+    cg.add_library("wjtje/qr-code-generator-library", "^1.7.0")
+    for conf in config.get(CONF_ON_JOB_COMPLETE, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+        await automation.build_automation(trigger, [], conf)
+    for conf in config.get(CONF_ON_QUEUE_EMPTY, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+        await automation.build_automation(trigger, [], conf)
 
     if lambda_config := config.get(CONF_LAMBDA):
         lambda_ = await cg.process_lambda(
-            lambda_config, [(display.DisplayRef, "it")], return_type=cg.void
+            lambda_config, [(ThermalPrinterDisplayRef, "it")], return_type=cg.void
         )
         cg.add(var.set_writer(lambda_))
 
@@ -55,9 +283,11 @@ async def to_code(config):
             {
                 cv.GenerateID(): cv.use_id(ThermalPrinterDisplay),
                 cv.Required(CONF_TEXT): cv.templatable(cv.string),
-                cv.Optional(CONF_FONT_SIZE, default=1): cv.templatable(
+                # Characters font_size + 1 times as wide and high
+                cv.Optional(CONF_FONT_SIZE, default=0): cv.templatable(
                     cv.int_range(min=0, max=7)
                 ),
+                cv.Optional(CONF_PRIORITY, default=0): cv.templatable(cv.uint8_t),
             }
         ),
         key=CONF_TEXT,
@@ -72,4 +302,251 @@ async def thermal_printer_print_text_action_to_code(
     cg.add(var.set_text(templ))
     templ = await cg.templatable(config[CONF_FONT_SIZE], args, cg.uint8)
     cg.add(var.set_font_size(templ))
+    templ = await cg.templatable(config[CONF_PRIORITY], args, cg.uint8)
+    cg.add(var.set_priority(templ))
+    return var
+
+
+@automation.register_action(
+    "thermal_printer.print_page",
+    ThermalPrinterPrintPageAction,
+    cv.Schema(
+        {
+            cv.GenerateID(): cv.use_id(ThermalPrinterDisplay),
+            cv.Optional(CONF_PRIORITY, default=0): cv.templatable(cv.uint8_t),
+        }
+    ),
+)
+async def thermal_printer_print_page_action_to_code(
+    config, action_id, template_arg, args
+):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    templ = await cg.templatable(config[CONF_PRIORITY], args, cg.uint8)
+    cg.add(var.set_priority(templ))
+    return var
+
+
+@automation.register_action(
+    "thermal_printer.feed",
+    ThermalPrinterFeedAction,
+    cv.maybe_simple_value(
+        cv.Schema(
+            {
+                cv.GenerateID(): cv.use_id(ThermalPrinterDisplay),
+                cv.Required(CONF_LINES): cv.templatable(cv.uint8_t),
+                cv.Optional(CONF_PRIORITY, default=0): cv.templatable(cv.uint8_t),
+            }
+        ),
+        key=CONF_LINES,
+    ),
+)
+async def thermal_printer_feed_action_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    templ = await cg.templatable(config[CONF_LINES], args, cg.uint8)
+    cg.add(var.set_lines(templ))
+    templ = await cg.templatable(config[CONF_PRIORITY], args, cg.uint8)
+    cg.add(var.set_priority(templ))
+    return var
+
+
+@automation.register_action(
+    "thermal_printer.cancel",
+    ThermalPrinterCancelAction,
+    automation.maybe_simple_id(
+        {
+            cv.GenerateID(): cv.use_id(ThermalPrinterDisplay),
+        }
+    ),
+)
+async def thermal_printer_cancel_action_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    return var
+
+
+@automation.register_action(
+    "thermal_printer.print_qrcode",
+    ThermalPrinterPrintQRCodeAction,
+    cv.maybe_simple_value(
+        cv.Schema(
+            {
+                cv.GenerateID(): cv.use_id(ThermalPrinterDisplay),
+                cv.Required(CONF_DATA): cv.templatable(cv.string),
+                cv.Optional(CONF_PRIORITY, default=0): cv.templatable(cv.uint8_t),
+            }
+        ),
+        key=CONF_DATA,
+    ),
+)
+async def thermal_printer_print_qrcode_action_to_code(
+    config, action_id, template_arg, args
+):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    templ = await cg.templatable(config[CONF_DATA], args, cg.std_string)
+    cg.add(var.set_data(templ))
+    templ = await cg.templatable(config[CONF_PRIORITY], args, cg.uint8)
+    cg.add(var.set_priority(templ))
+    return var
+
+
+@automation.register_action(
+    "thermal_printer.print_barcode",
+    ThermalPrinterPrintBarcodeAction,
+    cv.Schema(
+        {
+            cv.GenerateID(): cv.use_id(ThermalPrinterDisplay),
+            cv.Required(CONF_DATA): cv.templatable(cv.string),
+            cv.Optional(CONF_TYPE, default="CODE128"): cv.enum(
+                BARCODE_TYPES, upper=True
+            ),
+            cv.Optional(CONF_PRIORITY, default=0): cv.templatable(cv.uint8_t),
+        }
+    ),
+)
+async def thermal_printer_print_barcode_action_to_code(
+    config, action_id, template_arg, args
+):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    templ = await cg.templatable(config[CONF_DATA], args, cg.std_string)
+    cg.add(var.set_data(templ))
+    cg.add(var.set_type(config[CONF_TYPE]))
+    templ = await cg.templatable(config[CONF_PRIORITY], args, cg.uint8)
+    cg.add(var.set_priority(templ))
+    return var
+
+
+@automation.register_action(
+    "thermal_printer.print_image",
+    ThermalPrinterPrintImageAction,
+    cv.maybe_simple_value(
+        cv.Schema(
+            {
+                cv.GenerateID(): cv.use_id(ThermalPrinterDisplay),
+                cv.Required(CONF_IMAGE): cv.use_id(image.Image_),
+                cv.Optional(CONF_DITHER, default="FLOYD_STEINBERG"): cv.enum(
+                    DITHER_MODES, upper=True
+                ),
+                cv.Optional(CONF_PRIORITY, default=0): cv.templatable(cv.uint8_t),
+            }
+        ),
+        key=CONF_IMAGE,
+    ),
+)
+async def thermal_printer_print_image_action_to_code(
+    config, action_id, template_arg, args
+):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    img = await cg.get_variable(config[CONF_IMAGE])
+    cg.add(var.set_image(img))
+    cg.add(var.set_dither(config[CONF_DITHER]))
+    templ = await cg.templatable(config[CONF_PRIORITY], args, cg.uint8)
+    cg.add(var.set_priority(templ))
+    return var
+
+
+RECEIPT_LINE_SCHEMA = cv.maybe_simple_value(
+    cv.Schema(
+        {
+            cv.Required(CONF_TEXT): cv.templatable(cv.string),
+            cv.Optional(CONF_BOLD, default=False): cv.boolean,
+            cv.Optional(CONF_DOUBLE_HEIGHT, default=False): cv.boolean,
+            cv.Optional(CONF_DOUBLE_WIDTH, default=False): cv.boolean,
+            cv.Optional(CONF_UNDERLINE, default=False): cv.boolean,
+            cv.Optional(CONF_ALIGN, default="LEFT"): cv.enum(
+                RECEIPT_ALIGNS, upper=True
+            ),
+        }
+    ),
+    key=CONF_TEXT,
+)
+
+
+@automation.register_action(
+    "thermal_printer.print_receipt",
+    ThermalPrinterPrintReceiptAction,
+    cv.Schema(
+        {
+            cv.GenerateID(): cv.use_id(ThermalPrinterDisplay),
+            cv.Required(CONF_LINES): cv.ensure_list(RECEIPT_LINE_SCHEMA),
+            cv.Optional(CONF_PRIORITY, default=0): cv.templatable(cv.uint8_t),
+        }
+    ),
+)
+async def thermal_printer_print_receipt_action_to_code(
+    config, action_id, template_arg, args
+):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    for line in config[CONF_LINES]:
+        templ = await cg.templatable(line[CONF_TEXT], args, cg.std_string)
+        style = sum(bit for key, bit in RECEIPT_STYLES.items() if line[key])
+        align = cg.RawExpression(f"'{line[CONF_ALIGN]}'")
+        cg.add(var.add_line(templ, style, align))
+    templ = await cg.templatable(config[CONF_PRIORITY], args, cg.uint8)
+    cg.add(var.set_priority(templ))
+    return var
+
+
+@automation.register_action(
+    "thermal_printer.print_timing_test",
+    ThermalPrinterPrintTimingTestAction,
+    automation.maybe_simple_id(
+        {
+            cv.GenerateID(): cv.use_id(ThermalPrinterDisplay),
+        }
+    ),
+)
+async def thermal_printer_print_timing_test_action_to_code(
+    config, action_id, template_arg, args
+):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    return var
+
+
+@automation.register_action(
+    "thermal_printer.calibrate_timing",
+    ThermalPrinterCalibrateTimingAction,
+    automation.maybe_simple_id(
+        {
+            cv.GenerateID(): cv.use_id(ThermalPrinterDisplay),
+        }
+    ),
+)
+async def thermal_printer_calibrate_timing_action_to_code(
+    config, action_id, template_arg, args
+):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    return var
+
+
+# Templatable, so a template number's set_action can pass its value straight on
+@automation.register_action(
+    "thermal_printer.set_timing",
+    ThermalPrinterSetTimingAction,
+    cv.Schema(
+        {
+            cv.GenerateID(): cv.use_id(ThermalPrinterDisplay),
+            cv.Required(CONF_ROW_TIME): cv.templatable(
+                cv.positive_time_period_microseconds
+            ),
+            cv.Required(CONF_HEAT_SCALE): cv.templatable(cv.int_range(min=1, max=1000)),
+        }
+    ),
+)
+async def thermal_printer_set_timing_action_to_code(
+    config, action_id, template_arg, args
+):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    templ = await cg.templatable(config[CONF_ROW_TIME], args, cg.uint32)
+    cg.add(var.set_row_time(templ))
+    templ = await cg.templatable(config[CONF_HEAT_SCALE], args, cg.uint16)
+    cg.add(var.set_heat_scale(templ))
     return var
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <cinttypes>
+#include <vector>
+
+namespace esphome {
+namespace thermal_printer {
+
+enum DitherMode : uint8_t {
+  DITHER_THRESHOLD,        // Black below 50% luminance
+  DITHER_FLOYD_STEINBERG,  // Error diffusion, best for photos
+  DITHER_BAYER,            // 8x8 ordered dither, no state between rows
+};
+
+// Turns rows of 8-bit luminance (0 = black, 255 = white) into packed 1bpp printer dots, one row at a
+// time and top to bottom. Only Floyd-Steinberg keeps state between rows: the error terms of the
+// current and the next row, as 16-bit integers.
+class Ditherer {
+ public:
+  void init(DitherMode mode, int width) {
+    this->mode_ = mode;
+    this->width_ = width;
+    this->y_ = 0;
+    if (mode == DITHER_FLOYD_STEINBERG) {
+      // One spare entry on either side so the diffusion needs no bounds checks
+      this->error_.assign(2 * (width + 2), 0);
+    } else {
+      this->error_.clear();
+    }
+  }
+
+  // Dither the next row and OR its black dots into `out`, MSB first, starting at bit `offset`.
+  // With `out` null the row is only used to carry the error over to the next one. Returns the number
+  // of black dots.
+  uint16_t row(const uint8_t *luma, uint8_t *out, int offset) {
+    uint16_t dots = 0;
+    int16_t *current = nullptr;
+    int16_t *next = nullptr;
+    if (this->mode_ == DITHER_FLOYD_STEINBERG) {
+      current = this->error_.data() + ((this->y_ & 1) ? this->width_ + 2 : 0) + 1;
+      next = this->error_.data() + ((this->y_ & 1) ? 0 : this->width_ + 2) + 1;
+      std::fill(next - 1, next + this->width_ + 1, 0);
+    }
+    const uint8_t *bayer = BAYER_8X8 + (this->y_ & 7) * 8;
+
+    for (int x = 0; x < this->width_; x++) {
+      bool black;
+      if (this->mode_ == DITHER_FLOYD_STEINBERG) {
+        int16_t value = luma[x] + current[x];
+        black = value < 128;
+        int16_t error = black ? value : value - 255;
+        // 7/16 right, 3/16 below left, 5/16 below, 1/16 below right
+        current[x + 1] += (error * 7) >> 4;
+        next[x - 1] += (error * 3) >> 4;
+        next[x] += (error * 5) >> 4;
+        next[x + 1] += error >> 4;
+      } else if (this->mode_ == DITHER_BAYER) {
+        black = luma[x] < bayer[x & 7] * 4 + 2;
+      } else {
+        black = luma[x] < 128;
+      }
+      if (black) {
+        dots++;
+        if (out != nullptr) {
+          int bit = offset + x;
+          out[bit / 8] |= 0x80 >> (bit % 8);
+        }
+      }
+    }
+    this->y_++;
+    return dots;
+  }
+
+  // Move on to the next row without producing it. Only valid where no error needs carrying over.
+  void skip_row() { this->y_++; }
+
+ protected:
+  static constexpr uint8_t BAYER_8X8[64] = {
+      0,  32, 8,  40, 2,  34, 10, 42,  //
+      48, 16, 56, 24, 50, 18, 58, 26,  //
+      12, 44, 4,  36, 14, 46, 6,  38,  //
+      60, 28, 52, 20, 62, 30, 54, 22,  //
+      3,  35, 11, 43, 1,  33, 9,  41,  //
+      51, 19, 59, 27, 49, 17, 57, 25,  //
+      15, 47, 7,  39, 13, 45, 5,  37,  //
+      63, 31, 55, 23, 61, 29, 53, 21,  //
+  };
+
+  DitherMode mode_{DITHER_FLOYD_STEINBERG};
+  int width_{0};
+  int y_{0};
+  std::vector<int16_t> error_{};
+};
+
+}  // namespace thermal_printer
+}  // namespace esphome
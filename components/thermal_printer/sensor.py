@@ -0,0 +1,76 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import sensor
+from esphome.const import (
+    DEVICE_CLASS_DURATION,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    UNIT_MILLISECOND,
+)
+from .display import ThermalPrinterDisplay
+
+CONF_THERMAL_PRINTER_ID = "thermal_printer_id"
+CONF_BYTES_SENT = "bytes_sent"
+CONF_QUEUE_DEPTH = "queue_depth"
+CONF_QUEUE_HIGH_WATER_MARK = "queue_high_water_mark"
+CONF_RENDER_TIME = "render_time"
+CONF_PACED_TIME = "paced_time"
+CONF_JOB_DURATION = "job_duration"
+CONF_JOB_ESTIMATED_DURATION = "job_estimated_duration"
+CONF_JOBS_COMPLETED = "jobs_completed"
+
+UNIT_BYTES = "B"
+
+
+def _bytes_schema(state_class):
+    return sensor.sensor_schema(
+        unit_of_measurement=UNIT_BYTES,
+        accuracy_decimals=0,
+        state_class=state_class,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        icon="mdi:printer",
+    )
+
+
+def _duration_schema():
+    return sensor.sensor_schema(
+        unit_of_measurement=UNIT_MILLISECOND,
+        accuracy_decimals=0,
+        device_class=DEVICE_CLASS_DURATION,
+        state_class=STATE_CLASS_MEASUREMENT,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        icon="mdi:timer-outline",
+    )
+
+
+SENSORS = {
+    CONF_BYTES_SENT: _bytes_schema(STATE_CLASS_TOTAL_INCREASING),
+    CONF_QUEUE_DEPTH: _bytes_schema(STATE_CLASS_MEASUREMENT),
+    CONF_QUEUE_HIGH_WATER_MARK: _bytes_schema(STATE_CLASS_MEASUREMENT),
+    CONF_RENDER_TIME: _duration_schema(),
+    CONF_PACED_TIME: _duration_schema(),
+    CONF_JOB_DURATION: _duration_schema(),
+    CONF_JOB_ESTIMATED_DURATION: _duration_schema(),
+    CONF_JOBS_COMPLETED: sensor.sensor_schema(
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        icon="mdi:counter",
+    ),
+}
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(CONF_THERMAL_PRINTER_ID): cv.use_id(ThermalPrinterDisplay),
+        **{cv.Optional(key): schema for key, schema in SENSORS.items()},
+    }
+)
+
+
+async def to_code(config):
+    printer = await cg.get_variable(config[CONF_THERMAL_PRINTER_ID])
+    for key in SENSORS:
+        if key in config:
+            sens = await sensor.new_sensor(config[key])
+            cg.add(getattr(printer, f"set_{key}_sensor")(sens))
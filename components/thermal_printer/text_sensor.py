@@ -0,0 +1,25 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import text_sensor
+from esphome.const import ENTITY_CATEGORY_DIAGNOSTIC
+from .display import ThermalPrinterDisplay
+from .sensor import CONF_THERMAL_PRINTER_ID
+
+CONF_LAST_JOB = "last_job"
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(CONF_THERMAL_PRINTER_ID): cv.use_id(ThermalPrinterDisplay),
+        cv.Optional(CONF_LAST_JOB): text_sensor.text_sensor_schema(
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            icon="mdi:printer",
+        ),
+    }
+)
+
+
+async def to_code(config):
+    printer = await cg.get_variable(config[CONF_THERMAL_PRINTER_ID])
+    if CONF_LAST_JOB in config:
+        sens = await text_sensor.new_text_sensor(config[CONF_LAST_JOB])
+        cg.add(printer.set_last_job_text_sensor(sens))
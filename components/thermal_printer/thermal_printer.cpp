@@ -2,24 +2,28 @@
 // check TODOs, some are hardcoded for now.
 #include "thermal_printer.h"
 
+#include "esphome/core/hal.h"
+
+#include "code_pages.h"
+#include "qrcodegen.h"
+
+#include <algorithm>
 #include <cinttypes>
+#include <cmath>
+#include <cstring>
 
 namespace esphome {
 namespace thermal_printer {
 
 static const char *const TAG = "thermal_printer";
 
-// Though most of these printers are factory configured for 19200 baud
-// operation, a few rare specimens instead work at 9600.  If so, change
-// this constant.  This will NOT make printing slower!  The physical
-// print and feed mechanisms are the bottleneck, not the port speed.
-#define BAUDRATE 9600  // 19200 //!< How many bits per second the serial port should transfer //TODO
-
 // ASCII codes used by some of the printer config commands:
 #define ASCII_TAB '\t'  //!< Horizontal tab
 #define ASCII_LF '\n'   //!< Line feed
 #define ASCII_FF '\f'   //!< Form feed
 #define ASCII_CR '\r'   //!< Carriage return
+#define ASCII_EOT 4     //!< End of transmission
+#define ASCII_DLE 16    //!< Data link escape
 #define ASCII_DC2 18    //!< Device control 2
 #define ASCII_ESC 27    //!< Escape
 #define ASCII_FS 28     //!< Field separator
@@ -36,18 +40,14 @@ static const char *const TAG = "thermal_printer";
 // continue with other duties (e.g. receiving or decoding an image)
 // while the printer physically completes the task.
 
-/*!
- * Number of microseconds to issue one byte to the printer.  11 bits
- * (not 8) to accommodate idle, start and stop bits.  Idle time might
- * be unnecessary, but erring on side of caution here.
- */
-#define BYTE_TIME (((11L * 1000000L) + (BAUDRATE / 2)) / BAUDRATE)
+// The time to issue one byte to the printer (byte_time_) is derived from
+// the UART settings in update_byte_time_(), see there.
 
 #define text_size 'S'   // Letter size - default is S, options are S for Small, M for Medium, L for Large
 #define row_spacing 24  // Spacing between rows - default is 24, values range from minimum of 24 and maximum of 64
 
-#define dtr 255
-#define version 268
+#define QR_CODE_FIRMWARE 269  // Oldest firmware with native QR codes (GS ( k)
+#define PRINTER_BOOT_TIME 500  // Uptime (ms) before the printer can take data, it boots with us
 
 static const uint8_t SLEEP_OFF_CMD[] = {ASCII_ESC, '8', 0, 0};  // Sleep off (important!)
 static const uint8_t INIT_CMD[] = {ASCII_ESC, '@'};             // Init command
@@ -60,8 +60,57 @@ static const uint8_t PRINT_SETTINGS_CMD[] = {ASCII_ESC, '7'};  // Esc 7 (print s
 
 static const uint8_t ONLINE_CMD[] = {ASCII_ESC, '=', 1};
 static const uint8_t UNDERLINE_OFF_CMD[] = {ASCII_ESC, '-', 0};
+static const uint8_t UNDERLINE_ON_CMD[] = {ASCII_ESC, '-', 1};
 static const uint8_t INVERSE_OFF_CMD[] = {ASCII_GS, 'B', 0};
 
+static const uint8_t BAUD_RATE_CMD[] = {ASCII_ESC, '#', '#', 'S', 'B', 'D', 'R'};  // Baud rate follows, LSB first
+static const uint8_t STATUS_CMD[] = {ASCII_DLE, ASCII_EOT, 1};                      // Real-time printer status request
+static const uint8_t RASTER_HEADER_CMD[] = {ASCII_GS, 'v', '0', 0, 0, 0, 0, 0};     // Mode, width and height follow
+static const uint8_t FEED_ROWS_CMD_SIZE = 3;                                        // ESC J n
+static const uint8_t FONT_SIZE_CMD_SIZE = 3;                                        // GS ! n
+
+// Printer, offline cause, error cause and paper sensor status, each answered right away with one byte
+static const uint8_t STATUS_POLL_CMD[] = {ASCII_DLE, ASCII_EOT, 1, ASCII_DLE, ASCII_EOT, 2,
+                                          ASCII_DLE, ASCII_EOT, 3, ASCII_DLE, ASCII_EOT, 4};
+static const uint8_t IDLE_QUERY_CMD[] = {ASCII_GS, 'r', 1};  // Paper status, answered once processed in order
+static const uint32_t STATUS_TIMEOUT = 200;                  // ms to wait for replies
+static const uint32_t IDLE_QUERY_MIN_PAUSE = 100000;         // us of pause left worth asking to cut short
+
+static const uint8_t QR_CODE_MODEL_CMD[] = {ASCII_GS, '(', 'k', 4, 0, 49, 65, 50, 0};  // Model 2
+static const uint8_t QR_CODE_SIZE_CMD[] = {ASCII_GS, '(', 'k', 3, 0, 49, 67};         // Module size follows
+static const uint8_t QR_CODE_ECC_CMD[] = {ASCII_GS, '(', 'k', 3, 0, 49, 69, 48};      // Error correction L
+static const uint8_t QR_CODE_STORE_CMD[] = {ASCII_GS, '(', 'k', 0, 0, 49, 80, 48};    // Length + 3, data follows
+static const uint8_t QR_CODE_PRINT_CMD[] = {ASCII_GS, '(', 'k', 3, 0, 49, 81, 48};
+static const uint8_t QR_CODE_QUIET_ZONE = 4;  // Modules of white space around a QR code
+// Bytes that fit each QR code version (1-40) in byte mode at error correction L
+static const uint16_t QR_CODE_BYTE_CAPACITY[] = {17,   32,   53,   78,   106,  134,  154,  192,  230,  271,
+                                                 321,  367,  425,  458,  520,  586,  644,  718,  792,  858,
+                                                 929,  1003, 1091, 1171, 1273, 1367, 1465, 1528, 1628, 1732,
+                                                 1840, 1952, 2068, 2188, 2303, 2431, 2563, 2699, 2809, 2953};
+
+static const uint8_t BARCODE_SETTINGS_CMD[] = {ASCII_GS, 'H', 2, ASCII_GS, 'w', 3};  // Label below, width 3
+static const uint8_t BARCODE_PRINT_CMD[] = {ASCII_GS, 'k'};                           // Type follows
+
+// Size in modules of the smallest QR code holding len bytes, or 0 if none does. The printer may pick a
+// smaller one for digits or capitals, so this is an upper bound.
+static int qrcode_byte_mode_size(size_t len) {
+  for (int version = 1; version <= 40; version++) {
+    if (len <= QR_CODE_BYTE_CAPACITY[version - 1])
+      return 4 * version + 17;
+  }
+  return 0;
+}
+
+// GS v 0 header for a raster block of `rows` rows of `width` bytes.
+static void fill_raster_header(uint8_t *header, uint16_t width, uint16_t rows) {
+  memcpy(header, RASTER_HEADER_CMD, sizeof(RASTER_HEADER_CMD));
+  header[3] = 0;  // Mode
+  header[4] = width & 0xFF;
+  header[5] = (width >> 8) & 0xFF;
+  header[6] = rows & 0xFF;
+  header[7] = (rows >> 8) & 0xFF;
+}
+
 // === Character commands ===
 #define FONT_MASK (1 << 0)  //!< Select character font A or B
 #define INVERSE_MASK \
@@ -73,33 +122,78 @@ static const uint8_t INVERSE_OFF_CMD[] = {ASCII_GS, 'B', 0};
 #define DOUBLE_WIDTH_MASK (1 << 5)   //!< Turn on/off double-width printing mode
 #define STRIKE_MASK (1 << 6)         //!< Turn on/off deleteline mode
 
+static_assert(RECEIPT_BOLD == BOLD_MASK && RECEIPT_DOUBLE_HEIGHT == DOUBLE_HEIGHT_MASK &&
+                  RECEIPT_DOUBLE_WIDTH == DOUBLE_WIDTH_MASK,
+              "Receipt styles are print mode bits");
+static const uint8_t RECEIPT_PRINT_MODE_MASK = RECEIPT_BOLD | RECEIPT_DOUBLE_HEIGHT | RECEIPT_DOUBLE_WIDTH;
+static const size_t RECEIPT_STYLE_SIZE = 15;  // ESC t, ESC 3, ESC a, ESC ! and ESC - ahead of a text line
+
 /* stuff from jesse's m5stack_printer component */
 /*static const uint8_t ESC = 0x1B;
 static const uint8_t GS = 0x1D;
 
 static const uint8_t INIT_PRINTER_CMD[] = {ESC, 0x40};
-static const uint8_t BAUD_RATE_9600_CMD[] = {ESC, '#', '#', 'S', 'B', 'D', 'R', 0x80, 0x25, 0x00, 0x00};
-static const uint8_t BAUD_RATE_115200_CMD[] = {ESC, '#', '#', 'S', 'B', 'D', 'R', 0x00, 0xC2, 0x01, 0x00};
 
 static const uint8_t FONT_SIZE_CMD[] = {GS, '!'};
 static const uint8_t FONT_SIZE_RESET_CMD[] = {ESC, 0x14};
 
-static const uint8_t QR_CODE_SET_CMD[] = {GS, 0x28, 0x6B, 0x00, 0x00, 0x31, 0x50, 0x30};
-static const uint8_t QR_CODE_PRINT_CMD[] = {GS, 0x28, 0x6B, 0x03, 0x00, 0x31, 0x51, 0x30, 0x00};
-
-static const uint8_t BARCODE_ENABLE_CMD[] = {GS, 0x45, 0x43, 0x01};
-static const uint8_t BARCODE_DISABLE_CMD[] = {GS, 0x45, 0x43, 0x00};
-static const uint8_t BARCODE_PRINT_CMD[] = {GS, 0x6B};
-
 static const uint8_t BYTES_PER_LOOP = 120;
 */
 
 // setup()
 void ThermalPrinterDisplay::setup() {
   ESP_LOGD(TAG, "entering setup()");
+  this->update_byte_time_();
   this->init_internal_(this->get_buffer_length_());
+  // init_internal_() clears through fill(), which only clears dirty rows and none are marked yet
+  if (this->buffer_ != nullptr) {
+    memset(this->buffer_, 0, this->get_buffer_length_());
+  }
+  if (this->banner_) {
+    // Landscape either way; without the strip DisplayBuffer rotates every pixel instead
+    this->set_rotation(display::DISPLAY_ROTATION_90_DEGREES);
+    this->strip_stride_ = (this->get_buffer_rows_() + 7) / 8;
+    ExternalRAMAllocator<uint8_t> allocator(ExternalRAMAllocator<uint8_t>::ALLOW_FAILURE);
+    this->strip_ = allocator.allocate(this->strip_stride_ * PAPER_WIDTH);
+    if (this->strip_ == nullptr) {
+      ESP_LOGW(TAG, "Could not allocate a %u byte banner strip, rotating pixels as they are drawn",
+               (unsigned) (this->strip_stride_ * PAPER_WIDTH));
+    } else {
+      memset(this->strip_, 0, this->strip_stride_ * PAPER_WIDTH);
+    }
+    this->banner_ = this->strip_ != nullptr;
+  }
+  this->send_buffer_ = this->buffer_;
+  if (this->double_buffer_) {
+    ExternalRAMAllocator<uint8_t> allocator(ExternalRAMAllocator<uint8_t>::ALLOW_FAILURE);
+    uint8_t *second = nullptr;
+    if (this->get_buffer_rows_() < this->height_) {
+      ESP_LOGW(TAG, "Double buffering needs full-page mode, ignoring it");
+    } else if ((second = allocator.allocate(this->get_buffer_length_())) == nullptr) {
+      ESP_LOGW(TAG, "Could not allocate a second %u byte page buffer, rendering and sending pages in turn",
+               (unsigned) this->get_buffer_length_());
+    }
+    this->double_buffer_ = second != nullptr;
+    if (second != nullptr) {
+      memset(second, 0, this->get_buffer_length_());
+      this->send_buffer_ = second;
+    }
+  }
+  if (!this->tx_buffer_.init(this->tx_buffer_size_)) {
+    ESP_LOGE(TAG, "Could not allocate %u byte transmit buffer", (unsigned) this->tx_buffer_size_);
+    this->mark_failed();
+    return;
+  }
+  this->timing_pref_ = global_preferences->make_preference<TimingCoefficients>(fnv1_hash("thermal_printer_timing"));
+  if (this->config_timing_.has_value()) {
+    this->timing_ = *this->config_timing_;
+  } else if (!this->timing_pref_.load(&this->timing_)) {
+    this->timing_ = TimingCoefficients{};
+  }
 
   this->begin();
+  if (this->upgrade_baud_rate_ != 0 && this->upgrade_baud_rate_ != this->parent_->get_baud_rate())
+    this->upgradeBaudRate();
 
   this->setDefault();
   this->setSize(text_size);
@@ -107,24 +201,127 @@ void ThermalPrinterDisplay::setup() {
 
   this->feed(1);
   ESP_LOGD(TAG, "leaving setup()");
-  // old stuff from jesse's component
-  //  this->write_array(BAUD_RATE_115200_CMD, sizeof(BAUD_RATE_115200_CMD));
-  //  delay(10);
-  //  this->parent_->set_baud_rate(115200);
-  //  this->parent_->load_settings();
-  //  delay(10);
 
   // this->write_array(INIT_PRINTER_CMD, sizeof(INIT_PRINTER_CMD));
 }
 
+// Number of microseconds to issue one byte to the printer at the UART's
+// current settings: start, data, parity and stop bits, plus one bit of
+// idle time.  The idle time might be unnecessary, but erring on side of
+// caution here.
+void ThermalPrinterDisplay::update_byte_time_() {
+  uint32_t baud_rate = this->parent_->get_baud_rate();
+  uint32_t bits = 1 + this->parent_->get_data_bits() + this->parent_->get_stop_bits() + 1;
+  if (this->parent_->get_parity() != uart::UART_CONFIG_PARITY_NONE)
+    bits++;
+  this->byte_time_ = (bits * 1000000UL + baud_rate / 2) / baud_rate;
+}
+
+// ESC # # S B D R followed by the baud rate, LSB first.
+static const size_t BAUD_RATE_CMD_SIZE = sizeof(BAUD_RATE_CMD) + 4;
+static void baud_rate_cmd(uint32_t baud_rate, uint8_t *cmd) {
+  memcpy(cmd, BAUD_RATE_CMD, sizeof(BAUD_RATE_CMD));
+  for (size_t i = 0; i < 4; i++)
+    cmd[sizeof(BAUD_RATE_CMD) + i] = uint8_t(baud_rate >> (8 * i));
+}
+
+// Ask the printer to switch to upgrade_baud_rate_. The switch itself happens in switch_baud_rate_()
+// once everything before it has gone out at the old rate.
+void ThermalPrinterDisplay::upgradeBaudRate() {
+  uint8_t cmd[BAUD_RATE_CMD_SIZE];
+  baud_rate_cmd(this->upgrade_baud_rate_, cmd);
+  this->queue_data_(cmd, sizeof(cmd));
+  this->queue_mark_(TxMark::BAUD_RATE);
+}
+
+// Move the UART over to the new baud rate and check the printer still answers a status request.
+// If it doesn't, the printer may still have switched, so it is told at the new rate to go back before
+// the UART does. Returns true once done.
+bool ThermalPrinterDisplay::switch_baud_rate_() {
+  switch (this->baud_state_) {
+    case BAUD_IDLE:
+      // Give the printer a moment to act on the command before the line changes speed
+      this->baud_state_ = BAUD_SWITCH;
+      this->timeoutSet(50000L);
+      return false;
+    case BAUD_SWITCH: {
+      this->previous_baud_rate_ = this->parent_->get_baud_rate();
+      this->parent_->set_baud_rate(this->upgrade_baud_rate_);
+      this->parent_->load_settings(false);
+      this->update_byte_time_();
+      uint8_t c;
+      while (this->available() > 0)
+        this->read_byte(&c);
+      this->send_(STATUS_CMD, sizeof(STATUS_CMD));
+      this->baud_deadline_ = millis() + 200;
+      this->baud_state_ = BAUD_CHECK;
+      return false;
+    }
+    case BAUD_CHECK: {
+      uint8_t status;
+      if (this->available() > 0 && this->read_byte(&status) && (status & 0x93) == 0x12) {
+        ESP_LOGI(TAG, "Switched to %" PRIu32 " baud", this->upgrade_baud_rate_);
+        this->baud_state_ = BAUD_IDLE;
+        return true;
+      }
+      if ((int32_t) (millis() - this->baud_deadline_) < 0)
+        return false;
+      ESP_LOGW(TAG, "No answer at %" PRIu32 " baud, going back to %" PRIu32 " baud", this->upgrade_baud_rate_,
+               this->previous_baud_rate_);
+      uint8_t cmd[BAUD_RATE_CMD_SIZE];
+      baud_rate_cmd(this->previous_baud_rate_, cmd);
+      this->send_(cmd, sizeof(cmd));
+      this->timeoutSet(50000L);
+      this->baud_state_ = BAUD_REVERT;
+      return false;
+    }
+    case BAUD_REVERT: {
+      // The command has gone out at the new rate and the printer has had time to act on it
+      this->parent_->set_baud_rate(this->previous_baud_rate_);
+      this->parent_->load_settings(false);
+      this->update_byte_time_();
+      this->baud_state_ = BAUD_IDLE;
+      return true;
+    }
+  }
+  return true;
+}
+
+void ThermalPrinterDisplay::dump_config() {
+  LOG_DISPLAY("", "Thermal Printer", this);
+  ESP_LOGCONFIG(TAG, "  Paper Width: %d dots", PAPER_WIDTH);
+  ESP_LOGCONFIG(TAG, "  Height: %d", this->height_);
+  ESP_LOGCONFIG(TAG, "  Firmware: %u.%02u", firmware / 100, firmware % 100);
+  if (this->get_buffer_rows_() < this->height_) {
+    ESP_LOGCONFIG(TAG, "  Band Height: %d", this->get_buffer_rows_());
+  }
+  if (this->banner_) {
+    ESP_LOGCONFIG(TAG, "  Banner: YES, %d dots long", this->height_);
+  }
+  LOG_PIN("  DTR Pin: ", this->dtr_pin_);
+  if (this->status_interval_ != 0) {
+    ESP_LOGCONFIG(TAG, "  Status Interval: %" PRIu32 "ms", this->status_interval_);
+  }
+  if (this->upgrade_baud_rate_ != 0) {
+    ESP_LOGCONFIG(TAG, "  Upgrade Baud Rate: %" PRIu32, this->upgrade_baud_rate_);
+  }
+  ESP_LOGCONFIG(TAG, "  Max Chunk Height: %u", maxChunkHeight);
+  ESP_LOGCONFIG(TAG, "  Row Timing: %" PRIu32 "us + %u%% of heating time", this->timing_.row_time,
+                this->timing_.heat_scale);
+  ESP_LOGCONFIG(TAG, "  Max Loop Time: %" PRIu32 "ms", this->max_loop_time_);
+  ESP_LOGCONFIG(TAG, "  Job Queue Size: %u", this->job_queue_size_);
+  ESP_LOGCONFIG(TAG, "  Transmit Buffer: %u bytes (high water mark %u, dropped %" PRIu32 ")",
+                (unsigned) this->tx_buffer_.capacity(), (unsigned) this->tx_buffer_.high_water_mark(),
+                this->tx_dropped_);
+}
+
 // maps to Adafruit_Thermal::begin()
 void ThermalPrinterDisplay::begin() {
   ESP_LOGD(TAG, "entering begin()");
-  firmware = version;
   // The printer can't start receiving data immediately upon power up --
-  // it needs a moment to cold boot and initialize.  Allow at least 1/2
-  // sec of uptime before printer can receive data.
-  this->timeoutSet(500000L);
+  // it needs a moment to cold boot and initialize.  loop() sends nothing
+  // before PRINTER_BOOT_TIME of uptime, which other components' setup()
+  // may well have used up already.
 
   this->wake();
   this->reset();
@@ -132,43 +329,45 @@ void ThermalPrinterDisplay::begin() {
   this->setHeatConfig();
 
   // Enable DTR pin if requested
-  if (dtr < 255) {
-    // pinMode(dtrPin, INPUT_PULLUP); //TODO: implement pinMode
-    // this->write_byte(ASCII_GS, 'a', (1 << 5));
-    dtrEnabled = true;
+  if (this->dtr_pin_ != nullptr) {
+    this->dtr_pin_->setup();
+    this->dtr_isr_pin_ = this->dtr_pin_->to_isr();
+    this->dtr_ready_ = !this->dtr_pin_->digital_read();
+    this->dtr_pin_->attach_interrupt(ThermalPrinterDisplay::dtr_isr_, this, gpio::INTERRUPT_ANY_EDGE);
+    uint8_t dtr_arr[] = {ASCII_GS, 'a', (1 << 5)};
+    this->queue_data_(dtr_arr, sizeof(dtr_arr));
+    // Until the printer has seen the command the pin means nothing, keep pacing by estimate until then
+    this->queue_mark_(TxMark::DTR_ON);
   }
 
   dotPrintTime = 30000;  // See comments near top of file for
   dotFeedTime = 2100;    // an explanation of these values.
-  maxChunkHeight = 255;
   ESP_LOGD(TAG, "leaving begin()");
 }
 
 // This method sets the estimated completion time for a just-issued task.
 void ThermalPrinterDisplay::timeoutSet(unsigned long x) {
-  ESP_LOGD(TAG, "entering timeoutSet()");
+  this->job_estimate_ += x;
   if (!dtrEnabled)
     resumeTime = micros() + x;
-  ESP_LOGD(TAG, "leaving timeoutSet()");
 }
 
 // Wake the printer from a low-energy state.
 void ThermalPrinterDisplay::wake() {
   ESP_LOGD(TAG, "entering wake()");
-  timeoutSet(0);          // Reset timeout counter
-  this->write_byte(255);  // Wake
+  this->queue_byte_(255);  // Wake
   if (firmware >= 264) {
-    delay(50);
+    this->queue_pause_(50000L);
     // Sleep off (important!)
-    this->write_array(SLEEP_OFF_CMD, sizeof(SLEEP_OFF_CMD));
+    this->queue_data_(SLEEP_OFF_CMD, sizeof(SLEEP_OFF_CMD));
   } else {
     // Datasheet recommends a 50 mS delay before issuing further commands,
     // but in practice this alone isn't sufficient (e.g. text size/style
     // commands may still be misinterpreted on wake).  A slightly longer
     // delay, interspersed with NUL chars (no-ops) seems to help.
     for (uint8_t i = 0; i < 10; i++) {
-      this->write_byte(0);
-      timeoutSet(10000L);
+      this->queue_byte_(0);
+      this->queue_pause_(10000L);
     }
   }
   ESP_LOGD(TAG, "leaving wake()");
@@ -176,7 +375,15 @@ void ThermalPrinterDisplay::wake() {
 
 void ThermalPrinterDisplay::init_() {
   ESP_LOGD(TAG, "entering init_()");
-  this->write_array(INIT_CMD, sizeof(INIT_CMD));
+  this->queue_data_(INIT_CMD, sizeof(INIT_CMD));
+  // ESC @ restores the printer's own defaults, which vary between models. Rather than guess them,
+  // send every setting again the next time it is set.
+  this->settings_known_ = 0;
+  // It does put text back to Font A at normal size and the default 30 dot line height, which is what
+  // wrapping and print time estimates go by
+  printMode = 0;
+  adjustCharValues(printMode);
+  lineSpacing = 6;
 }
 
 // Reset printer to default state.
@@ -186,16 +393,13 @@ void ThermalPrinterDisplay::reset() {
   this->init_();
   prevByte = '\n';  // Treat as if prior line is blank
   column = 0;
-  maxColumn = 32;
-  charHeight = 24;
-  lineSpacing = 6;
   barcodeHeight = 50;
 
   if (firmware >= 264) {
     // Configure tab stops on recent printers
-    this->write_array(TAB_STOP_CMD, sizeof(TAB_STOP_CMD));                // Set tab stops...
-    this->write_array(TAB_STOP_CMD_4_COLS, sizeof(TAB_STOP_CMD_4_COLS));  // ...every 4 columns,
-    this->write_array(TAB_STOP_CMD_STOP, sizeof(TAB_STOP_CMD_STOP));      // 0 marks end-of-list.
+    this->queue_data_(TAB_STOP_CMD, sizeof(TAB_STOP_CMD));                // Set tab stops...
+    this->queue_data_(TAB_STOP_CMD_4_COLS, sizeof(TAB_STOP_CMD_4_COLS));  // ...every 4 columns,
+    this->queue_data_(TAB_STOP_CMD_STOP, sizeof(TAB_STOP_CMD_STOP));      // 0 marks end-of-list.
   }
   ESP_LOGD(TAG, "leaving reset()");
 }
@@ -219,10 +423,12 @@ void ThermalPrinterDisplay::reset() {
 // but slower printing speed.
 void ThermalPrinterDisplay::setHeatConfig(uint8_t dots, uint8_t time, uint8_t interval) {
   ESP_LOGD(TAG, "entering setHeatConfig()");
-  this->write_array(PRINT_SETTINGS_CMD, sizeof(PRINT_SETTINGS_CMD));  // Esc 7 (print settings)
-  this->write_byte(dots);
-  this->write_byte(time);
-  this->write_byte(interval);  // Heating dots, heat time, heat interval
+  heatDots = dots;
+  heatTime = time;
+  heatInterval = interval;
+  this->queue_data_(PRINT_SETTINGS_CMD, sizeof(PRINT_SETTINGS_CMD));  // Esc 7 (print settings)
+  uint8_t heat_config_arr[] = {dots, time, interval};                  // Heating dots, heat time, heat interval
+  this->queue_data_(heat_config_arr, sizeof(heat_config_arr));
   ESP_LOGD(TAG, "leaving setHeatConfig()");
 }
 
@@ -231,20 +437,20 @@ void ThermalPrinterDisplay::setDefault() {
   ESP_LOGD(TAG, "entering setDefault()");
   this->online();
   this->justify('L');
-  this->inverseOff();
-  this->doubleHeightOff();
+  if (firmware >= 268)
+    this->inverseOff();  // Older firmware inverts through the print mode, cleared below
+  // Inverse, bold, double height and double width off with a single ESC !
+  this->unsetPrintMode(INVERSE_MASK | BOLD_MASK | DOUBLE_HEIGHT_MASK | DOUBLE_WIDTH_MASK);
   this->setLineHeight(30);
-  this->boldOff();
   this->underlineOff();
   this->setBarcodeHeight(50);
-  this->setSize('s');
   this->setCharset();
-  this->setCodePage();
+  this->setCodePage(this->code_page_);
   ESP_LOGD(TAG, "leaving setDefault()");
 }
 
 // Take the printer back online. Subsequent print commands will be obeyed.
-void ThermalPrinterDisplay::online() { this->write_array(ONLINE_CMD, sizeof(ONLINE_CMD)); }
+void ThermalPrinterDisplay::online() { this->queue_setting_(SETTING_ONLINE, ONLINE_CMD, sizeof(ONLINE_CMD)); }
 
 void ThermalPrinterDisplay::justify(char value) {
   uint8_t pos = 0;
@@ -262,12 +468,12 @@ void ThermalPrinterDisplay::justify(char value) {
   }
 
   uint8_t justify_arr[] = {ASCII_ESC, 'a', pos};
-  this->write_array(justify_arr, sizeof(justify_arr));
+  this->queue_setting_(SETTING_JUSTIFY, justify_arr, sizeof(justify_arr));
 }
 
 void ThermalPrinterDisplay::inverseOff() {
   if (firmware >= 268) {
-    this->write_array(INVERSE_OFF_CMD, sizeof(INVERSE_OFF_CMD));
+    this->queue_setting_(SETTING_INVERSE, INVERSE_OFF_CMD, sizeof(INVERSE_OFF_CMD));
   } else {
     unsetPrintMode(INVERSE_MASK);
   }
@@ -289,7 +495,9 @@ void ThermalPrinterDisplay::boldOn() { setPrintMode(BOLD_MASK); }
 
 void ThermalPrinterDisplay::boldOff() { unsetPrintMode(BOLD_MASK); }
 
-void ThermalPrinterDisplay::underlineOff() { this->write_array(UNDERLINE_OFF_CMD, sizeof(UNDERLINE_OFF_CMD)); }
+void ThermalPrinterDisplay::underlineOff() {
+  this->queue_setting_(SETTING_UNDERLINE, UNDERLINE_OFF_CMD, sizeof(UNDERLINE_OFF_CMD));
+}
 
 void ThermalPrinterDisplay::setLineHeight(int val) {
   if (val < 24)
@@ -301,7 +509,7 @@ void ThermalPrinterDisplay::setLineHeight(int val) {
   // spacing.  Default line spacing is 30 (char height of 24, line
   // spacing of 6).
   uint8_t line_height_arr[] = {ASCII_ESC, '3', (uint8_t) val};
-  this->write_array(line_height_arr, sizeof(line_height_arr));
+  this->queue_setting_(SETTING_LINE_HEIGHT, line_height_arr, sizeof(line_height_arr));
 }
 
 void ThermalPrinterDisplay::setBarcodeHeight(uint8_t val) {  // Default is 50
@@ -309,38 +517,27 @@ void ThermalPrinterDisplay::setBarcodeHeight(uint8_t val) {  // Default is 50
     val = 1;
   barcodeHeight = val;
   uint8_t barcode_height_arr[] = {ASCII_GS, 'h', val};
-  this->write_array(barcode_height_arr, sizeof(barcode_height_arr));
+  this->queue_setting_(SETTING_BARCODE_HEIGHT, barcode_height_arr, sizeof(barcode_height_arr));
 }
 
 void ThermalPrinterDisplay::setSize(char value) {
-  uint8_t size;
+  // Both size bits change in one ESC !, rather than one command per bit
+  uint8_t mode = printMode & ~(DOUBLE_HEIGHT_MASK | DOUBLE_WIDTH_MASK);
 
   switch (toupper(value)) {
     default:  // Small: standard width and height
-      // size = 0x00;
-      // charHeight = 24;
-      // maxColumn = 32;
-      doubleWidthOff();
-      doubleHeightOff();
       break;
     case 'M':  // Medium: double height
-      // size = 0x01;
-      // charHeight = 48;
-      // maxColumn = 32;
-      doubleHeightOn();
-      doubleWidthOff();
+      mode |= DOUBLE_HEIGHT_MASK;
       break;
     case 'L':  // Large: double width and height
-      // size = 0x11;
-      // charHeight = 48;
-      // maxColumn = 16;
-      doubleHeightOn();
-      doubleWidthOn();
+      mode |= DOUBLE_HEIGHT_MASK | DOUBLE_WIDTH_MASK;
       break;
   }
 
-  // writeBytes(ASCII_GS, '!', size);
-  // prevByte = '\n'; // Setting the size adds a linefeed
+  printMode = mode;
+  writePrintMode();
+  adjustCharValues(printMode);
 }
 
 // Alters some chars in ASCII 0x23-0x7E range; see datasheet
@@ -348,15 +545,16 @@ void ThermalPrinterDisplay::setCharset(uint8_t val) {
   if (val > 15)
     val = 15;
   uint8_t charset_arr[] = {ASCII_ESC, 'R', val};
-  this->write_array(charset_arr, sizeof(charset_arr));
+  this->queue_setting_(SETTING_CHARSET, charset_arr, sizeof(charset_arr));
 }
 
 // Selects alt symbols for 'upper' ASCII values 0x80-0xFF
 void ThermalPrinterDisplay::setCodePage(uint8_t val) {
   if (val > 47)
     val = 47;
+  this->code_page_ = val;
   uint8_t codepage_arr[] = {ASCII_ESC, 't', val};
-  this->write_array(codepage_arr, sizeof(codepage_arr));
+  this->queue_setting_(SETTING_CODE_PAGE, codepage_arr, sizeof(codepage_arr));
 }
 
 // Feeds by the specified number of lines
@@ -364,8 +562,8 @@ void ThermalPrinterDisplay::feed(uint8_t x) {
   ESP_LOGD(TAG, "entering feed()");
   if (firmware >= 264) {
     uint8_t feed_arr[] = {ASCII_ESC, 'd', x};
-    this->write_array(feed_arr, sizeof(feed_arr));
-    timeoutSet(dotFeedTime * charHeight);
+    this->queue_data_(feed_arr, sizeof(feed_arr));
+    this->queue_pause_(dotFeedTime * charHeight);
     prevByte = '\n';
     column = 0;
   } else {
@@ -392,44 +590,154 @@ void ThermalPrinterDisplay::unsetPrintMode(uint8_t mask) {
 
 void ThermalPrinterDisplay::writePrintMode() {
   uint8_t printModeArr[] = {ASCII_ESC, '!', printMode};
-  this->write_array(printModeArr, sizeof(printModeArr));
+  this->queue_setting_(SETTING_PRINT_MODE, printModeArr, sizeof(printModeArr));
 }
 
 // The underlying method for all high-level printing (e.g. println()).
 // The inherited Print class handles the rest!
 size_t ThermalPrinterDisplay::write(uint8_t c) {
-  ESP_LOGD(TAG, "entering write()");
   if (c != 13) {  // Strip carriage returns
-    timeoutWait();
-    char str[2] = {static_cast<char>(c), '\0'};
-    this->write_str(str);
-    unsigned long d = BYTE_TIME;
-    if ((c == '\n') || (column == maxColumn)) {                               // If newline or wrap
-      d += (prevByte == '\n') ? ((charHeight + lineSpacing) * dotFeedTime) :  // Feed line
-               ((charHeight * dotPrintTime) + (lineSpacing * dotFeedTime));   // Text line
+    this->queue_byte_(c);
+    unsigned long d = 0;  // Transfer time is accounted for by loop()
+    if ((c == '\n') || (column == maxColumn)) {  // If newline or wrap
+      d += this->lineTime();
       column = 0;
       c = '\n';  // Treat wrap as newline on next pass
     } else {
       column++;
     }
-    timeoutSet(d);
+    this->queue_pause_(d);
     prevByte = c;
   }
-  ESP_LOGD(TAG, "leaving write()");
   return 1;
 }
 
-// This function waits (if necessary) for the prior task to complete.
-void ThermalPrinterDisplay::timeoutWait() {
+// Time to print (or, after a blank line, just feed) the line ending here.
+unsigned long ThermalPrinterDisplay::lineTime() {
+  return (prevByte == '\n') ? ((charHeight + lineSpacing) * dotFeedTime) :  // Feed line
+             ((charHeight * dotPrintTime) + (lineSpacing * dotFeedTime));  // Text line
+}
+
+// Estimated time to print one raster row with the given number of black dots. The print head fires
+// at most (heatDots + 1) * 8 dots at once, so a row takes one heating cycle (heat time plus heat
+// interval, both in units of 10us) per group of that many dots, on top of a fixed per-row cost for
+// stepping the paper. The fixed cost and a scale on the heating part come from calibration.
+unsigned long ThermalPrinterDisplay::rowTime(uint16_t dots) {
+  return this->timing_.row_time +
+         this->dot_groups_(dots) * (heatTime + heatInterval) * 10UL * this->timing_.heat_scale / 100;
+}
+
+// Heating cycles the print head needs for a row with the given number of black dots.
+uint32_t ThermalPrinterDisplay::dot_groups_(uint16_t dots) {
+  uint16_t group = (uint16_t(heatDots) + 1) * 8;
+  return (dots + group - 1) / group;
+}
+
+void ThermalPrinterDisplay::set_timing_coefficients(uint32_t row_time, uint16_t heat_scale) {
+  this->timing_.row_time = row_time;
+  this->timing_.heat_scale = heat_scale;
+  this->timing_pref_.save(&this->timing_);
+  ESP_LOGI(TAG, "Timing set to %" PRIu32 "us per row + %u%% of heating time", row_time, heat_scale);
+}
+
+// Print a page of bands at falling density (100%, 50%, 25%, 12.5% black), paced with the current
+// timing coefficients. Bands that come out compressed or streaky mean the estimate is too short for
+// that density; adjust with set_timing_coefficients().
+void ThermalPrinterDisplay::print_timing_test() {
+  if (this->render_buffer_busy_()) {
+    ESP_LOGW(TAG, "Previous page is still printing, skipping timing test");
+    return;
+  }
+  this->page_prerendered_ = false;
+  this->timing_test_ = true;
+  this->update();
+}
+
+// Print the timing test with each band's raster block timed by the printer: instead of waiting out
+// the estimate after a block, ask with GS r when the printer is done with it. The blocks' times are
+// fitted to their rows and dot groups once the page is done.
+void ThermalPrinterDisplay::calibrate_timing() {
+  if (!this->status_answered_) {
+    ESP_LOGW(TAG, "Timing calibration needs the printer's replies, set status_interval and wire RX");
+    return;
+  }
+  if (this->page_queued_ || this->page_sending_) {
+    ESP_LOGW(TAG, "Previous page is still printing, skipping timing calibration");
+    return;
+  }
+  this->calibration_ = CalibrationSums{};
+  this->calibrating_ = true;
+  this->print_timing_test();
+}
+
+// The printer's reply to the GS r after a timed block. It starts on the block once the first row is
+// in, so from then on the reply took the rows' print time, unless they printed faster than the UART
+// delivered them and the time says nothing about the printer.
+void ThermalPrinterDisplay::add_calibration_sample_(uint32_t now) {
+  float rows = this->block_rows_;
+  float groups = this->block_groups_;
+  float time = int32_t(now - this->block_sent_ - (ROW_BYTES + 1) * this->byte_time_);
+  if (time < rows * ROW_BYTES * this->byte_time_) {
+    ESP_LOGD(TAG, "Block of %d rows printed as fast as it arrived, not timing it", this->block_rows_);
+    return;
+  }
+  ESP_LOGD(TAG, "Block of %d rows, %" PRIu32 " dot groups printed in %.0f us", this->block_rows_,
+           this->block_groups_, time);
+  CalibrationSums &sums = this->calibration_;
+  sums.rows_rows += rows * rows;
+  sums.rows_groups += rows * groups;
+  sums.groups_groups += groups * groups;
+  sums.rows_time += rows * time;
+  sums.groups_time += groups * time;
+  sums.blocks++;
+}
+
+// Solve for the per-row time and the time per dot group, which gives heat_scale against the
+// configured heat time and interval.
+void ThermalPrinterDisplay::finish_calibration_() {
+  this->calibrating_ = false;
+  const CalibrationSums &sums = this->calibration_;
+  float det = sums.rows_rows * sums.groups_groups - sums.rows_groups * sums.rows_groups;
+  if (sums.blocks < 2 || det <= 0.01f * sums.rows_rows * sums.groups_groups) {
+    ESP_LOGW(TAG, "Timing calibration needs two bands of different density that print slower than they arrive, "
+                  "got %u timed blocks; try a higher baud rate",
+             sums.blocks);
+    return;
+  }
+  float row_time = (sums.groups_groups * sums.rows_time - sums.rows_groups * sums.groups_time) / det;
+  float group_time = (sums.rows_rows * sums.groups_time - sums.rows_groups * sums.rows_time) / det;
+  float heat_scale = group_time * 100 / ((heatTime + heatInterval) * 10.0f);
+  if (row_time < 0 || heat_scale < 1 || heat_scale > 65535) {
+    ESP_LOGW(TAG, "Timing calibration came out at %.0fus per row + %.0f%% of heating time, keeping the old timing",
+             row_time, heat_scale);
+    return;
+  }
+  this->set_timing_coefficients(lroundf(row_time), lroundf(heat_scale));
+}
+
+void ThermalPrinterDisplay::draw_timing_test_() {
+  static const uint8_t PATTERNS[][2] = {{0xFF, 0xFF}, {0xAA, 0x55}, {0x88, 0x22}, {0x80, 0x08}};
+  static const int BAND_ROWS = 48;
+  int rows = std::min(this->get_buffer_rows_(), this->height_ - this->band_start_);
+  for (int y = 0; y < rows; y++) {
+    int page_row = this->band_start_ + y;
+    int band = page_row / BAND_ROWS;
+    if (band >= 4 || page_row % BAND_ROWS >= BAND_ROWS - 8)
+      continue;  // Gap after each band
+    memset(this->buffer_ + ROW_BYTES * y, PATTERNS[band][page_row % 2], ROW_BYTES);
+    this->mark_dirty_(y, y);
+  }
+}
+
+// This function checks (without waiting) whether the prior task has completed.
+bool ThermalPrinterDisplay::timeoutExpired() {
+  if (this->status_hold_ && this->at_boundary_) {
+    return false;  // A command already under way is finished first
+  }
   if (dtrEnabled) {
-    /*while (digitalRead(dtrPin) == HIGH) {
-      yield();
-    };*/
-  } else {
-    while ((long) (micros() - resumeTime) < 0L) {
-      yield();
-    };  // (syntax is rollover-proof)
+    return this->dtr_ready_;  // Printer holds DTR low while it can take more data
   }
+  return (int32_t) (micros() - resumeTime) >= 0;  // (syntax is rollover-proof)
 }
 
 void ThermalPrinterDisplay::adjustCharValues(uint8_t printMode) {
@@ -452,121 +760,1591 @@ void ThermalPrinterDisplay::adjustCharValues(uint8_t printMode) {
   if (printMode & DOUBLE_HEIGHT_MASK) {
     charHeight *= 2;
   }
-  maxColumn = (384 / charWidth);
+  maxColumn = PAPER_WIDTH / charWidth;
 }
 
 //---stuff from Jesse's m5stack_printer component
 void ThermalPrinterDisplay::print_text(std::string text, uint8_t font_size) {
-  ESP_LOGD(TAG, "entering print_text()");
-  this->init_();
-  /*font_size = clamp<uint8_t>(font_size, 0, 7);
-  this->write_array(FONT_SIZE_CMD, sizeof(FONT_SIZE_CMD));
-  this->write_byte(font_size | (font_size << 4));*/
+  this->init_();  // Clears whatever was left in the printer's line buffer
+  column = 0;
+  font_size = std::min<uint8_t>(font_size, 7);
+
+  std::vector<std::string> lines = wrap_text(text, column, std::max(maxColumn / (font_size + 1), 1));
+  size_t length = font_size != 0 ? 2 * FONT_SIZE_CMD_SIZE : 0;
+  for (auto &line : lines)
+    length += line.size();
+  if (length > this->tx_buffer_.free()) {
+    ESP_LOGW(TAG, "Transmit buffer full (%u bytes free), dropping %u bytes of text", (unsigned) this->tx_buffer_.free(),
+             (unsigned) length);
+    this->tx_dropped_ += length;
+    return;
+  }
 
-  for (char c : text) {
-    this->write(static_cast<uint8_t>(c));
+  if (font_size != 0)
+    this->set_font_size_(font_size);
+  for (auto &line : lines)
+    this->queue_text_line_(line);
+  if (font_size != 0)
+    this->set_font_size_(0);
+  ESP_LOGD(TAG, "Queued %u lines of text", (unsigned) lines.size());
+}
+
+// Make characters font_size + 1 times as wide and high with GS !, 0 being normal size as after ESC @.
+// Wrapping and line times follow. Returns false if the command doesn't fit the transmit buffer.
+bool ThermalPrinterDisplay::set_font_size_(uint8_t font_size) {
+  uint8_t scale = font_size + 1;
+  uint8_t font_size_arr[FONT_SIZE_CMD_SIZE] = {ASCII_GS, '!', uint8_t(font_size << 4 | font_size)};
+  if (!this->queue_data_(font_size_arr, sizeof(font_size_arr)))
+    return false;
+  adjustCharValues(printMode);
+  charHeight *= scale;
+  maxColumn = std::max(maxColumn / scale, 1);
+  return true;
+}
+
+// Queue one line from wrapText() with a single write and a single timeout, rather than per
+// character. Returns false if it doesn't fit the transmit buffer.
+bool ThermalPrinterDisplay::queue_text_line_(const std::string &line) {
+  if (!this->queue_data_(reinterpret_cast<const uint8_t *>(line.data()), line.size()))
+    return false;
+  if (line.back() == '\n') {
+    this->queue_pause_(this->lineTime());
+    column = 0;
+  } else {
+    column += line.size();
   }
-  ESP_LOGD(TAG, "leaving print_text()");
+  prevByte = line.back();
+  return true;
+}
+
+bool ThermalPrinterDisplay::enqueue_job(PrintJob &&job) {
+  if (this->jobs_.size() >= this->job_queue_size_) {
+    ESP_LOGW(TAG, "Job queue full (%u jobs), dropping job", (unsigned) this->jobs_.size());
+    return false;
+  }
+  auto it = std::find_if(this->jobs_.begin(), this->jobs_.end(),
+                         [&job](const PrintJob &queued) { return queued.priority < job.priority; });
+  this->jobs_.insert(it, std::move(job));
+  return true;
+}
+
+bool ThermalPrinterDisplay::enqueue_text(const std::string &text, uint8_t font_size, uint8_t priority) {
+  PrintJob job{PrintJob::TEXT, priority};
+  job.font_size = font_size;
+  job.text = text;
+  return this->enqueue_job(std::move(job));
+}
+
+bool ThermalPrinterDisplay::enqueue_page(uint8_t priority) {
+  return this->enqueue_job(PrintJob{PrintJob::PAGE, priority});
+}
+
+bool ThermalPrinterDisplay::enqueue_feed(uint8_t lines, uint8_t priority) {
+  PrintJob job{PrintJob::FEED, priority};
+  job.lines = lines;
+  return this->enqueue_job(std::move(job));
+}
+
+bool ThermalPrinterDisplay::enqueue_qrcode(const std::string &data, uint8_t priority) {
+  PrintJob job{PrintJob::QRCODE, priority};
+  job.text = data;
+  return this->enqueue_job(std::move(job));
+}
 
-  /*this->write_array(FONT_SIZE_RESET_CMD, sizeof(FONT_SIZE_RESET_CMD));*/
+bool ThermalPrinterDisplay::enqueue_barcode(const std::string &barcode, BarcodeType type, uint8_t priority) {
+  PrintJob job{PrintJob::BARCODE, priority};
+  job.text = barcode;
+  job.barcode_type = type;
+  return this->enqueue_job(std::move(job));
+}
+
+bool ThermalPrinterDisplay::enqueue_image(image::Image *image, DitherMode mode, uint8_t priority) {
+  PrintJob job{PrintJob::IMAGE, priority};
+  job.image = image;
+  job.dither = mode;
+  return this->enqueue_job(std::move(job));
+}
+
+bool ThermalPrinterDisplay::enqueue_receipt(std::vector<ReceiptLine> lines, uint8_t priority) {
+  PrintJob job{PrintJob::RECEIPT, priority};
+  job.receipt = std::move(lines);
+  return this->enqueue_job(std::move(job));
+}
+
+void ThermalPrinterDisplay::cancel_jobs() {
+  ESP_LOGD(TAG, "Cancelling %u queued jobs", (unsigned) this->jobs_.size());
+  this->jobs_.clear();
+  this->page_prerendered_ = false;
+  if (!this->print_job_active_)
+    this->queue_empty_callback_.call();
+}
+
+// Take the next job off the queue and start it. Called once the printer is idle.
+void ThermalPrinterDisplay::start_print_job_() {
+  PrintJob job = std::move(this->jobs_.front());
+  this->jobs_.pop_front();
+  this->print_job_active_ = true;
+  this->start_job_();
+  switch (job.type) {
+    case PrintJob::TEXT:
+      this->init_();
+      column = 0;
+      this->job_font_size_ = std::min<uint8_t>(job.font_size, 7);
+      if (this->job_font_size_ != 0)
+        this->set_font_size_(this->job_font_size_);
+      this->job_lines_ = this->wrapText(job.text);
+      this->job_line_ = 0;
+      this->continue_print_job_();
+      break;
+    case PrintJob::PAGE:
+      this->update();
+      break;
+    case PrintJob::FEED:
+      this->feed(job.lines);
+      break;
+    case PrintJob::QRCODE:
+      if (firmware >= QR_CODE_FIRMWARE) {
+        this->print_qrcode(job.text);
+        break;
+      }
+      this->job_qr_size_ = this->encode_qrcode_(job.text, this->job_qr_);
+      if (this->job_qr_size_ == 0) {
+        this->job_qr_.clear();
+        break;
+      }
+      this->init_();
+      this->queue_feed_rows_(QR_CODE_QUIET_ZONE * this->qrcode_scale_(this->job_qr_size_));
+      this->job_qr_row_ = 0;
+      this->continue_print_job_();
+      break;
+    case PrintJob::BARCODE:
+      this->print_barcode(job.text, static_cast<BarcodeType>(job.barcode_type));
+      break;
+    case PrintJob::IMAGE:
+      if (job.image == nullptr)
+        break;
+      this->init_();
+      if (job.image->get_type() == image::IMAGE_TYPE_BINARY) {
+        this->raw_image_ = job.image;
+        this->raw_image_row_ = 0;
+        this->raw_block_end_ = 0;
+        this->queue_mark_(TxMark::IMAGE);
+        break;
+      }
+      this->job_image_ = job.image;
+      this->job_image_row_ = 0;
+      this->job_ditherer_.init(job.dither, std::min(job.image->get_width(), this->get_width_internal()));
+      this->continue_print_job_();
+      break;
+    case PrintJob::RECEIPT:
+      this->init_();
+      column = 0;
+      lineSpacing = row_spacing - 24;  // Receipts keep the configured line height, sent with the first text line
+      this->plan_receipt_(job.receipt);
+      this->job_receipt_row_ = 0;
+      this->continue_print_job_();
+      break;
+  }
+}
+
+// Text jobs are queued a line at a time and raster QR codes a module row at a time as the transmit
+// buffer drains, so they aren't limited by its size. Receipts go a printer line at a time.
+void ThermalPrinterDisplay::continue_print_job_() {
+  if (!this->job_qr_.empty()) {
+    while (this->job_qr_row_ < this->job_qr_size_) {
+      if (!this->queue_qrcode_row_(this->job_qr_.data(), this->job_qr_size_, this->job_qr_row_))
+        return;
+      this->job_qr_row_++;
+    }
+    this->queue_feed_rows_(QR_CODE_QUIET_ZONE * this->qrcode_scale_(this->job_qr_size_));
+    this->job_qr_.clear();
+    this->job_qr_.shrink_to_fit();
+  }
+  if (this->job_image_ != nullptr) {
+    while (this->job_image_row_ < this->job_image_->get_height()) {
+      if (!this->queue_image_rows_())
+        return;
+    }
+    this->job_image_ = nullptr;
+    this->job_ditherer_.init(DITHER_THRESHOLD, 0);  // Free the error rows
+  }
+
+  if (!this->queue_job_lines_())
+    return;
+  if (this->job_font_size_ != 0) {
+    if (!this->set_font_size_(0))
+      return;
+    this->job_font_size_ = 0;
+  }
+
+  while (this->job_receipt_row_ < this->job_receipt_.size() || !this->job_raster_.empty()) {
+    if (!this->job_raster_.empty()) {
+      if (!this->queue_raster_rows_())
+        return;
+      continue;
+    }
+    const ReceiptRow &row = this->job_receipt_[this->job_receipt_row_];
+    if (RECEIPT_STYLE_SIZE + (row.raster ? 0 : row.data.size()) > this->tx_buffer_.free() &&
+        !this->tx_buffer_.empty())
+      return;
+    this->start_receipt_row_(row);
+    this->job_receipt_row_++;
+  }
+  if (!this->job_receipt_.empty()) {
+    if (std::any_of(this->job_receipt_.begin(), this->job_receipt_.end(),
+                    [](const ReceiptRow &row) { return !row.raster; })) {
+      // Back to the default style for whatever is printed next
+      printMode &= ~RECEIPT_PRINT_MODE_MASK;
+      writePrintMode();
+      adjustCharValues(printMode);
+      this->underlineOff();
+      this->justify('L');
+    }
+    this->job_receipt_.clear();
+    this->job_receipt_row_ = 0;
+  }
+}
+
+// Queue the wrapped lines of a TEXT job, as many as fit the transmit buffer. Returns false if some
+// are left.
+bool ThermalPrinterDisplay::queue_job_lines_() {
+  while (this->job_line_ < this->job_lines_.size()) {
+    const std::string &line = this->job_lines_[this->job_line_];
+    if (line.size() > this->tx_buffer_.free()) {
+      if (!this->tx_buffer_.empty())
+        return false;
+      ESP_LOGW(TAG, "Line of %u bytes doesn't fit the transmit buffer, dropping it", (unsigned) line.size());
+      this->tx_dropped_ += line.size();
+    } else {
+      this->queue_text_line_(line);
+    }
+    this->job_line_++;
+  }
+  this->job_lines_.clear();
+  this->job_line_ = 0;
+  return true;
+}
+
+// Split text into printer lines of at most maxColumn characters, starting from the current column.
+std::vector<std::string> ThermalPrinterDisplay::wrapText(const std::string &text) {
+  return wrap_text(text, column, maxColumn);
+}
+
+// Split text into printer lines of at most `width` characters, the first starting at `column`.
+// Lines are broken at the last space where there is one, and every complete line ends in '\n'; the
+// last line is left open if the text doesn't end with a newline.
+std::vector<std::string> ThermalPrinterDisplay::wrap_text(const std::string &text, uint8_t column, uint8_t width) {
+  std::vector<std::string> lines;
+  std::string line;
+  uint8_t col = column;
+  width = std::max<uint8_t>(width, 1);
+  bool wrapped = false;
+
+  for (char c : text) {
+    if (c == '\r')
+      continue;  // Strip carriage returns
+    if (c == '\n') {
+      lines.push_back(line + '\n');
+      line.clear();
+      col = 0;
+      wrapped = false;
+      continue;
+    }
+    if (c == ' ' && wrapped && line.empty())
+      continue;  // Drop the space a wrap was made at
+    if (c == ' ' && col >= width) {
+      // The line is full and ends in a whole word: wrap at this space
+      lines.push_back(line + '\n');
+      line.clear();
+      col = 0;
+      wrapped = true;
+      continue;
+    }
+    if (col >= width) {
+      size_t space = line.rfind(' ');
+      std::string rest;
+      if (space != std::string::npos) {
+        rest = line.substr(space + 1);
+        line.resize(space);
+      }
+      lines.push_back(line + '\n');
+      line = rest;
+      col = rest.size();
+      wrapped = true;
+    }
+    line += c;
+    col++;
+  }
+  if (!line.empty())
+    lines.push_back(line);
+  return lines;
 }
 
 void ThermalPrinterDisplay::new_line(uint8_t lines) {
   for (uint8_t i = 0; i < lines; i++) {
-    this->write_byte('\n');
+    this->queue_byte_('\n');
   }
 }
 
-// this doesn't work yet
+// Print data as a QR code: natively where the firmware supports it, which takes a few bytes more
+// than the data, else as raster.
 void ThermalPrinterDisplay::print_qrcode(std::string data) {
+  if (firmware >= QR_CODE_FIRMWARE) {
+    this->init_();
+    this->queue_qrcode_native_(data);
+    return;
+  }
+  std::vector<uint8_t> qr;
+  int size = this->encode_qrcode_(data, qr);
+  if (size == 0) {
+    return;
+  }
   this->init_();
 
-  /*size_t len;
-  uint8_t len_low, len_high;
-  len = data.length() + 3;
-  len_low = len & 0xFF;
-  len_high = len >> 8;
+  // Raster is all or nothing here; print jobs stream it a module row at a time instead
+  int scale = this->qrcode_scale_(size);
+  size_t length = size * (sizeof(RASTER_HEADER_CMD) + scale * this->qrcode_row_bytes_(size, scale));
+  if (length + 2 * FEED_ROWS_CMD_SIZE > this->tx_buffer_.free()) {
+    ESP_LOGW(TAG, "Transmit buffer full (%u bytes free), dropping %u byte QR code", (unsigned) this->tx_buffer_.free(),
+             (unsigned) length);
+    this->tx_dropped_ += length;
+    return;
+  }
+  this->queue_feed_rows_(QR_CODE_QUIET_ZONE * scale);
+  for (int row = 0; row < size; row++)
+    this->queue_qrcode_row_(qr.data(), size, row);
+  this->queue_feed_rows_(QR_CODE_QUIET_ZONE * scale);
+}
+
+// Draw data as a QR code into the page, `scale` pixels per module, with its top left corner at x, y.
+void ThermalPrinterDisplay::draw_qrcode(int x, int y, const std::string &data, int scale, Color color) {
+  std::vector<uint8_t> qr;
+  int size = this->encode_qrcode_(data, qr);
+  for (int row = 0; row < size; row++) {
+    // Runs of black modules are filled a byte at a time
+    int run = 0;
+    for (int module = 0; module <= size; module++) {
+      if (module < size && qrcodegen_getModule(qr.data(), module, row)) {
+        run++;
+      } else if (run > 0) {
+        this->filled_rectangle(x + (module - run) * scale, y + row * scale, run * scale, scale, color);
+        run = 0;
+      }
+    }
+  }
+}
+
+// Encode data into qr, returning its size in modules or 0 if it can't be encoded. Takes about 8 kB of
+// heap while encoding.
+int ThermalPrinterDisplay::encode_qrcode_(const std::string &data, std::vector<uint8_t> &qr) {
+  std::vector<uint8_t> temp(qrcodegen_BUFFER_LEN_MAX);
+  qr.resize(qrcodegen_BUFFER_LEN_MAX);
+  if (!qrcodegen_encodeText(data.c_str(), temp.data(), qr.data(), qrcodegen_Ecc_LOW, qrcodegen_VERSION_MIN,
+                            qrcodegen_VERSION_MAX, qrcodegen_Mask_AUTO, true)) {
+    ESP_LOGE(TAG, "Can't encode %u bytes as a QR code", (unsigned) data.size());
+    return 0;
+  }
+  int size = qrcodegen_getSize(qr.data());
+  int scale = this->qrcode_scale_(size);
+  if (scale == 0) {
+    ESP_LOGE(TAG, "QR code of %d modules doesn't fit the paper and transmit buffer", size);
+    return 0;
+  }
+  if (scale < this->qr_module_size_)
+    ESP_LOGD(TAG, "QR code of %d modules printed at %d dots per module", size, scale);
+  return size;
+}
 
-  uint8_t qr_code_cmd[sizeof(QR_CODE_SET_CMD)];
-  memcpy(qr_code_cmd, QR_CODE_SET_CMD, sizeof(QR_CODE_SET_CMD));
-  qr_code_cmd[3] = len_low;
-  qr_code_cmd[4] = len_high;
-  this->write_array(qr_code_cmd, sizeof(qr_code_cmd));
-  this->write_str(data.c_str());
-  this->write_byte(0x00);
+// Dots per module: qr_module_size_, reduced if needed to fit the code and its quiet zone on the paper,
+// and a module row into the transmit buffer. A raster code is queued a module row at a time, so a row
+// that could never fit would hold up the job queue for good.
+int ThermalPrinterDisplay::qrcode_scale_(int size) {
+  int scale = std::min<int>(this->qr_module_size_, this->get_width_internal() / (size + 2 * QR_CODE_QUIET_ZONE));
+  while (scale > 0 &&
+         sizeof(RASTER_HEADER_CMD) + scale * this->qrcode_row_bytes_(size, scale) > this->tx_buffer_.capacity())
+    scale--;
+  return scale;
+}
 
-  this->write_array(QR_CODE_PRINT_CMD, sizeof(QR_CODE_PRINT_CMD));
-  */
+// Bytes per raster row of a QR code centred on the paper.
+uint16_t ThermalPrinterDisplay::qrcode_row_bytes_(int size, int scale) {
+  int left = (this->get_width_internal() - size * scale) / 2;
+  return (left + size * scale + 7) / 8;
 }
 
-// this doesn't work yet
+bool ThermalPrinterDisplay::queue_qrcode_native_(const std::string &data) {
+  int size = qrcode_byte_mode_size(data.size());
+  if (size == 0) {
+    ESP_LOGE(TAG, "Can't encode %u bytes as a QR code", (unsigned) data.size());
+    return false;
+  }
+  size_t len = data.size() + 3;
+  size_t total = sizeof(QR_CODE_MODEL_CMD) + sizeof(QR_CODE_SIZE_CMD) + 1 + sizeof(QR_CODE_ECC_CMD) +
+                 sizeof(QR_CODE_STORE_CMD) + data.size() + sizeof(QR_CODE_PRINT_CMD);
+  if (total > this->tx_buffer_.free()) {
+    ESP_LOGW(TAG, "Transmit buffer full, dropping %u byte QR code", (unsigned) total);
+    this->tx_dropped_ += total;
+    return false;
+  }
+  uint8_t store_arr[sizeof(QR_CODE_STORE_CMD)];
+  memcpy(store_arr, QR_CODE_STORE_CMD, sizeof(QR_CODE_STORE_CMD));
+  store_arr[3] = len & 0xFF;
+  store_arr[4] = (len >> 8) & 0xFF;
+  this->queue_data_(QR_CODE_MODEL_CMD, sizeof(QR_CODE_MODEL_CMD));
+  this->queue_data_(QR_CODE_SIZE_CMD, sizeof(QR_CODE_SIZE_CMD));
+  this->queue_byte_(this->qr_module_size_);
+  this->queue_data_(QR_CODE_ECC_CMD, sizeof(QR_CODE_ECC_CMD));
+  this->queue_data_(store_arr, sizeof(store_arr));
+  this->queue_data_(reinterpret_cast<const uint8_t *>(data.data()), data.size());
+  this->queue_data_(QR_CODE_PRINT_CMD, sizeof(QR_CODE_PRINT_CMD));
+
+  // About half of the modules are black
+  int dots = size * this->qr_module_size_;
+  this->queue_pause_(dots * this->rowTime(dots / 2) + 2 * QR_CODE_QUIET_ZONE * this->qr_module_size_ * dotFeedTime);
+  prevByte = '\n';
+  return true;
+}
+
+// Queue one module row of a QR code as a raster block of `scale` identical rows. Returns false if
+// it doesn't fit the transmit buffer.
+bool ThermalPrinterDisplay::queue_qrcode_row_(const uint8_t *qr, int size, int row) {
+  int scale = this->qrcode_scale_(size);
+  uint16_t width = this->qrcode_row_bytes_(size, scale);
+  if (sizeof(RASTER_HEADER_CMD) + width * scale > this->tx_buffer_.free()) {
+    return false;
+  }
+
+  std::vector<uint8_t> line(width, 0);
+  int x = (this->get_width_internal() - size * scale) / 2;
+  uint16_t dots = 0;
+  for (int module = 0; module < size; module++, x += scale) {
+    if (!qrcodegen_getModule(qr, module, row))
+      continue;
+    for (int i = x; i < x + scale; i++)
+      line[i / 8] |= 0x80 >> (i % 8);
+    dots += scale;
+  }
+
+  uint8_t header[sizeof(RASTER_HEADER_CMD)];
+  fill_raster_header(header, width, scale);
+  this->queue_data_(header, sizeof(header));
+  for (int i = 0; i < scale; i++)
+    this->queue_data_(line.data(), width);
+  this->queue_pause_(scale * this->rowTime(dots));
+  return true;
+}
+
+// Feed the paper by the given number of dot rows (ESC J n).
+void ThermalPrinterDisplay::queue_feed_rows_(int rows) {
+  while (rows > 0) {
+    uint8_t n = std::min(rows, 255);
+    uint8_t feed_arr[FEED_ROWS_CMD_SIZE] = {ASCII_ESC, 'J', n};
+    this->queue_data_(feed_arr, sizeof(feed_arr));
+    this->queue_pause_(n * dotFeedTime);
+    rows -= n;
+  }
+}
+
+// Luminance of image row y, columns [x1, x2), 0 = black. Binary images read as black on white.
+void ThermalPrinterDisplay::read_luminance_(image::Image *image, int y, int x1, int x2, uint8_t *luma) {
+  static const Color BLACK(0, 0, 0);
+  static const Color WHITE(255, 255, 255);
+  for (int x = x1; x < x2; x++) {
+    Color c = image->get_pixel(x, y, BLACK, WHITE);
+    *luma++ = (c.r * 77 + c.g * 150 + c.b * 29) >> 8;
+  }
+}
+
+void ThermalPrinterDisplay::draw_image_dithered(int x, int y, image::Image *image, DitherMode mode) {
+  if (this->buffer_ == nullptr || image == nullptr) {
+    return;
+  }
+  int x1 = std::max(x, 0);
+  int x2 = std::min(x + image->get_width(), this->get_width_internal());
+  int y1 = y;
+  int y2 = y + image->get_height();
+  if (this->is_clipping()) {
+    display::Rect clip = this->get_clipping();
+    x1 = std::max<int>(x1, clip.x);
+    x2 = std::min<int>(x2, clip.x + clip.w);
+    y1 = std::max<int>(y1, clip.y);
+    y2 = std::min<int>(y2, clip.y + clip.h);
+  }
+  bool rotated = this->rotation_ != display::DISPLAY_ROTATION_0_DEGREES;
+  if (!rotated) {
+    // Nothing below the current band; rows above it are dithered too when the error carries over
+    y2 = std::min(y2, this->band_start_ + this->get_buffer_rows_());
+    if (mode != DITHER_FLOYD_STEINBERG)
+      y1 = std::max(y1, this->band_start_);
+  }
+  if (x1 >= x2 || y1 >= y2) {
+    return;
+  }
+
+  uint32_t start = micros();
+  Ditherer ditherer;
+  ditherer.init(mode, x2 - x1);
+  std::vector<uint8_t> luma(x2 - x1);
+  std::vector<uint8_t> line;
+  if (rotated)
+    line.resize((x2 - x1 + 7) / 8);
+  for (int page_row = y; page_row < y2; page_row++) {
+    if (page_row < y1) {
+      ditherer.skip_row();
+      continue;
+    }
+    this->read_luminance_(image, page_row - y, x1 - x, x2 - x, luma.data());
+    if (rotated) {
+      // Goes through the rotation in draw_pixel_at() a dot at a time
+      std::fill(line.begin(), line.end(), 0);
+      ditherer.row(luma.data(), line.data(), 0);
+      for (int i = 0; i < x2 - x1; i++) {
+        if (line[i / 8] & (0x80 >> (i % 8)))
+          this->draw_pixel_at(x1 + i, page_row, display::COLOR_ON);
+      }
+      continue;
+    }
+    int buffer_row = page_row - this->band_start_;
+    uint8_t *out = buffer_row >= 0 ? this->buffer_ + ROW_BYTES * buffer_row : nullptr;
+    if (ditherer.row(luma.data(), out, x1) != 0 && out != nullptr)
+      this->mark_dirty_(buffer_row, buffer_row);
+  }
+  ESP_LOGV(TAG, "Dithered %d rows in %" PRIu32 "us", y2 - y1, micros() - start);
+}
+
+// Queue the next rows of the image job as one GS v 0 block, as many as fit the transmit buffer.
+// Returns false when nothing fits. An image whose rows can never fit is dropped.
+bool ThermalPrinterDisplay::queue_image_rows_() {
+  image::Image *image = this->job_image_;
+  int width = std::min(image->get_width(), this->get_width_internal());
+  int offset = (this->get_width_internal() - width) / 2;
+  uint16_t row_bytes = (offset + width + 7) / 8;
+  int rows = std::min<int>(image->get_height() - this->job_image_row_, maxChunkHeight);
+  if (sizeof(RASTER_HEADER_CMD) + row_bytes > this->tx_buffer_.capacity()) {
+    ESP_LOGW(TAG, "Image row of %u bytes doesn't fit the transmit buffer, dropping the image", (unsigned) row_bytes);
+    this->tx_dropped_ += (image->get_height() - this->job_image_row_) * row_bytes;
+    this->job_image_row_ = image->get_height();
+    return true;
+  }
+  // Wait for room for a block of at least half the transmit buffer, so headers stay a small overhead
+  int half = (this->tx_buffer_.capacity() / 2 - sizeof(RASTER_HEADER_CMD)) / row_bytes;
+  int wanted = std::min(rows, std::max(half, 1));
+  size_t free = this->tx_buffer_.free();
+  if (free <= sizeof(RASTER_HEADER_CMD))
+    return false;
+  rows = std::min<int>(rows, (free - sizeof(RASTER_HEADER_CMD)) / row_bytes);
+  if (rows < wanted)
+    return false;
+
+  uint8_t header[sizeof(RASTER_HEADER_CMD)];
+  fill_raster_header(header, row_bytes, rows);
+  this->queue_data_(header, sizeof(header));
+  std::vector<uint8_t> luma(width);
+  std::vector<uint8_t> wrapped;
+  unsigned long d = 0;
+  for (int i = 0; i < rows; i++) {
+    // Dither straight into the transmit buffer, unless the row wraps around its end
+    size_t granted;
+    uint8_t *line = this->tx_buffer_.reserve(row_bytes, &granted);
+    if (granted < row_bytes) {
+      wrapped.resize(row_bytes);
+      line = wrapped.data();
+    }
+    memset(line, 0, row_bytes);
+    this->read_luminance_(image, this->job_image_row_ + i, 0, width, luma.data());
+    d += this->rowTime(this->job_ditherer_.row(luma.data(), line, offset));
+    if (granted < row_bytes) {
+      this->queue_data_(line, row_bytes);
+    } else {
+      this->tx_buffer_.commit(row_bytes);
+    }
+  }
+  this->queue_pause_(d);
+  this->job_image_row_ += rows;
+  return true;
+}
+
+// Stream a binary image as GS v 0 blocks of at most maxChunkHeight rows, straight from the image
+// component's data: it is already packed MSB first, one bit per dot and each row padded to whole
+// bytes. Rows are centred by sending the white margin from a shared blank row. Returns true once
+// the image has been sent.
+bool ThermalPrinterDisplay::send_image_() {
+  static const uint8_t BLANK_ROW[ROW_BYTES] = {};
+  image::Image *image = this->raw_image_;
+  const uint8_t *data = image->get_data_start();
+  size_t stride = (image->get_width() + 7) / 8;
+  size_t width = std::min(stride, ROW_BYTES);  // Cropped to the paper
+  size_t margin = (ROW_BYTES - width) / 2;
+
+  if (this->raw_image_row_ < this->raw_block_end_) {
+    size_t budget = this->bytes_per_pass_();
+    size_t sent = 0;
+    do {
+      if (margin > 0)
+        this->send_(BLANK_ROW, margin);
+      this->send_image_data_(data + stride * this->raw_image_row_, width);
+      sent += margin + width;
+      this->raw_image_row_++;
+    } while (this->raw_image_row_ < this->raw_block_end_ && sent + margin + width <= budget);
+
+    unsigned long d = sent * this->byte_time_;
+    if (this->raw_image_row_ == this->raw_block_end_)
+      d += this->raw_block_time_;  // Hold off the next block until the printer is done with this one
+    this->timeoutSet(d);
+    return false;
+  }
+  if (this->raw_image_row_ >= image->get_height())
+    return true;
+
+  int rows = std::min<int>(image->get_height() - this->raw_image_row_, std::max<int>(1, maxChunkHeight));
+  this->raw_block_end_ = this->raw_image_row_ + rows;
+  this->raw_block_time_ = 0;
+  for (int y = this->raw_image_row_; y < this->raw_block_end_; y++) {
+    const uint8_t *row = data + stride * y;
+    uint16_t dots = 0;
+    for (size_t i = 0; i < width; i++)
+      dots += __builtin_popcount(progmem_read_byte(row + i));
+    this->raw_block_time_ += this->rowTime(dots);
+  }
+  uint8_t header[sizeof(RASTER_HEADER_CMD)];
+  fill_raster_header(header, margin + width, rows);
+  this->send_(header, sizeof(header));
+  this->timeoutSet(sizeof(header) * this->byte_time_);
+  return false;
+}
+
+// Image data lives in flash. The ESP8266 can only read that a word at a time, so there each row is
+// copied out first; elsewhere flash is mapped into the address space and goes to the UART as it is.
+void ThermalPrinterDisplay::send_image_data_(const uint8_t *data, size_t len) {
+#ifdef USE_ESP8266
+  uint8_t row[ROW_BYTES];
+  for (size_t i = 0; i < len; i++)
+    row[i] = progmem_read_byte(data + i);
+  this->send_(row, len);
+#else
+  this->send_(data, len);
+#endif
+}
+
+// Print a barcode with the printer's own GS k command, which every firmware supports in one of two
+// forms: with a length byte (2.64 and later) or NUL terminated with the older type numbers.
 void ThermalPrinterDisplay::print_barcode(std::string barcode, BarcodeType type) {
   this->init_();
+  this->feed(1);  // Recent firmware can't print barcode w/o feed first???
+  size_t len = std::min<size_t>(barcode.size(), 255);
+  if (sizeof(BARCODE_SETTINGS_CMD) + sizeof(BARCODE_PRINT_CMD) + 2 + len > this->tx_buffer_.free()) {
+    ESP_LOGW(TAG, "Transmit buffer full, dropping barcode");
+    this->tx_dropped_ += len;
+    return;
+  }
+  this->queue_data_(BARCODE_SETTINGS_CMD, sizeof(BARCODE_SETTINGS_CMD));
+  this->queue_data_(BARCODE_PRINT_CMD, sizeof(BARCODE_PRINT_CMD));
+  if (firmware >= 264) {
+    this->queue_byte_(type);
+    this->queue_byte_(len);
+    this->queue_data_(reinterpret_cast<const uint8_t *>(barcode.data()), len);
+  } else {
+    this->queue_byte_(type - UPC_A);
+    this->queue_data_(reinterpret_cast<const uint8_t *>(barcode.data()), len);
+    this->queue_byte_(0);
+  }
+  this->queue_pause_((barcodeHeight + 40) * dotPrintTime);
+  prevByte = '\n';
+}
 
-  /*this->write_array(BARCODE_ENABLE_CMD, sizeof(BARCODE_ENABLE_CMD));
+// Append bytes to the transmit buffer. A command is queued whole or not at all: if it doesn't fit,
+// it is dropped and counted rather than letting the queue grow without bound.
+bool ThermalPrinterDisplay::queue_data_(const uint8_t *data, size_t size) {
+  if (!this->tx_buffer_.push(data, size)) {
+    ESP_LOGW(TAG, "Transmit buffer full, dropping %u bytes", (unsigned) size);
+    this->tx_dropped_ += size;
+    return false;
+  }
+  this->job_pushes_++;
+  return true;
+}
 
-  this->write_array(BARCODE_PRINT_CMD, sizeof(BARCODE_PRINT_CMD));
-  this->write_byte(type);
-  this->write_byte(barcode.length());
-  this->write_str(barcode.c_str());
-  this->write_byte(0x00);
+// Queue a command whose last byte sets `setting`, unless the printer is known to hold that value
+// already. Commands queued back to back leave the transmit buffer in a single UART write.
+bool ThermalPrinterDisplay::queue_setting_(Setting setting, const uint8_t *cmd, size_t size) {
+  uint16_t bit = 1 << setting;
+  uint8_t value = cmd[size - 1];
+  if ((this->settings_known_ & bit) && this->settings_[setting] == value) {
+    this->job_commands_dropped_++;
+    return true;
+  }
+  if (!this->queue_data_(cmd, size))
+    return false;
+  this->settings_[setting] = value;
+  this->settings_known_ |= bit;
+  return true;
+}
 
-  this->write_array(BARCODE_DISABLE_CMD, sizeof(BARCODE_DISABLE_CMD));*/
+bool ThermalPrinterDisplay::queue_byte_(uint8_t data) {
+  size_t granted;
+  uint8_t *dst = this->tx_buffer_.reserve(1, &granted);
+  if (granted == 0) {
+    ESP_LOGW(TAG, "Transmit buffer full, dropping 1 byte");
+    this->tx_dropped_++;
+    return false;
+  }
+  *dst = data;
+  this->tx_buffer_.commit(1);
+  this->job_pushes_++;
+  return true;
 }
 
-// this doesn't work yet
-void ThermalPrinterDisplay::queue_data_(std::vector<uint8_t> data) {
-  /*for (size_t i = 0; i < data.size(); i += BYTES_PER_LOOP) {
-    std::vector<uint8_t> chunk(data.begin() + i, data.begin() + std::min(i + BYTES_PER_LOOP, data.size()));
-    this->queue_.push(chunk);
-  }*/
+// Hold back everything queued after this point until the printer has had `us` microseconds to
+// act on what was queued before it.
+void ThermalPrinterDisplay::queue_pause_(uint32_t us) {
+  if (us == 0) {
+    return;
+  }
+  uint32_t pos = this->tx_buffer_.write_pos();
+  if (!this->marks_.empty() && this->marks_.back().pos == pos && this->marks_.back().type == TxMark::PAUSE) {
+    this->marks_.back().pause += us;
+    return;
+  }
+  TxMark mark{pos, TxMark::PAUSE};
+  mark.pause = us;
+  this->marks_.push(mark);
+}
+
+void ThermalPrinterDisplay::queue_mark_(TxMark::Type type) {
+  this->marks_.push(TxMark{this->tx_buffer_.write_pos(), type});
+}
+
+// Write straight to the UART, noting when the bytes will have left it.
+void ThermalPrinterDisplay::send_(const uint8_t *data, size_t len) {
+  this->write_array(data, len);
+  this->bytes_sent_ += len;
+  this->job_bytes_ += len;
+  this->job_writes_++;
+  this->transfer_done_ = micros() + len * this->byte_time_;
 }
-// this doesn't work yet
-void ThermalPrinterDisplay::queue_data_(const uint8_t *data, size_t size) {
-  /*for (size_t i = 0; i < size; i += BYTES_PER_LOOP) {
-    size_t chunk_size = std::min(i + BYTES_PER_LOOP, size) - i;
-    std::vector<uint8_t> chunk(data + i, data + i + chunk_size);
-    this->queue_.push(chunk);
-  }*/
+
+void IRAM_ATTR ThermalPrinterDisplay::dtr_isr_(ThermalPrinterDisplay *arg) {
+  arg->dtr_ready_ = !arg->dtr_isr_pin_.digital_read();
+}
+
+// Bytes that fit in one loop() pass without exceeding max_loop_time_.
+size_t ThermalPrinterDisplay::bytes_per_pass_() {
+  return std::max<size_t>(1, this->max_loop_time_ * 1000UL / this->byte_time_);
 }
 
 void ThermalPrinterDisplay::loop() {
-  if (this->queue_.empty()) {
+  if (this->paced_) {
+    this->paced_time_ += micros() - this->paced_since_;
+    this->paced_ = false;
+  }
+  if (this->init_state_ == INIT_BOOT) {
+    if (millis() < PRINTER_BOOT_TIME)
+      return;
+    this->init_state_ = INIT_SENDING;
+  }
+  if (this->status_interval_ != 0 && this->baud_state_ == BAUD_IDLE)
+    this->update_status_();
+  this->continue_print_job_();
+  if (this->double_buffer_ && !this->page_prerendered_ && !this->render_buffer_busy_() && !this->jobs_.empty() &&
+      this->jobs_.front().type == PrintJob::PAGE && (!this->tx_buffer_.empty() || !this->marks_.empty())) {
+    // The next job is a page and the printer is still busy: render it now, so it can go out the moment
+    // its turn comes instead of after the writer has run
+    this->render_page_();
+    this->page_prerendered_ = true;
+  }
+  if (this->tx_buffer_.empty() && this->marks_.empty()) {
+    if (this->init_state_ == INIT_SENDING && this->timeoutExpired()) {
+      this->init_state_ = INIT_READY;
+      ESP_LOGI(TAG, "Printer ready after %" PRIu32 " ms", millis());
+    }
+    if (this->job_active_ && this->timeoutExpired())
+      this->finish_job_();
+    if (!this->job_active_ && !this->jobs_.empty() && this->is_ready() && this->timeoutExpired())
+      this->start_print_job_();
+  }
+  if (this->tx_buffer_.empty() && this->marks_.empty()) {
+    this->high_freq_.stop();
+    return;
+  }
+  this->high_freq_.start();
+  if (!this->job_active_)
+    this->start_job_();
+
+  const uint32_t start = millis();
+  while (this->timeoutExpired() && (int32_t) (micros() - this->transfer_done_) >= 0 &&
+         millis() - start < this->max_loop_time_) {
+    uint32_t pos = this->tx_buffer_.read_pos();
+    if (!this->marks_.empty() && this->marks_.front().pos == pos) {
+      TxMark &mark = this->marks_.front();
+      if (mark.type == TxMark::BAUD_RATE) {
+        if (this->switch_baud_rate_()) {
+          this->marks_.pop();
+        } else if (this->baud_state_ == BAUD_CHECK) {
+          break;  // Look for the answer on the next loop() rather than spin on it
+        }
+      } else if (mark.type == TxMark::PAGE) {
+        if (!this->page_sending_)
+          this->begin_page_();
+        this->at_boundary_ = false;
+        if (this->send_page_()) {
+          this->at_boundary_ = true;
+          this->marks_.pop();
+          this->page_sending_ = false;
+          this->timing_test_ = false;
+          if (this->calibrating_)
+            this->finish_calibration_();
+#ifdef USE_SENSOR
+          if (this->render_time_sensor_ != nullptr)
+            this->render_time_sensor_->publish_state(this->render_time_ / 1000.0f);
+#endif
+          ESP_LOGD(TAG, "Page sent, transmit buffer high water mark: %u/%u bytes",
+                   (unsigned) this->tx_buffer_.high_water_mark(), (unsigned) this->tx_buffer_.capacity());
+        }
+      } else if (mark.type == TxMark::IMAGE) {
+        this->at_boundary_ = false;
+        if (this->send_image_()) {
+          this->at_boundary_ = true;
+          this->marks_.pop();
+          this->raw_image_ = nullptr;
+        }
+      } else {
+        if (mark.type == TxMark::DTR_ON)
+          dtrEnabled = true;
+        this->timeoutSet(mark.pause);
+        this->marks_.pop();
+        this->at_boundary_ = true;
+      }
+      continue;
+    }
+
+    // Send straight out of the ring buffer, up to the next mark
+    size_t len;
+    const uint8_t *data = this->tx_buffer_.peek(&len);
+    if (!this->marks_.empty()) {
+      len = std::min<size_t>(len, this->marks_.front().pos - pos);
+    }
+    if (len == 0) {
+      break;
+    }
+    len = std::min(len, this->bytes_per_pass_());
+    this->send_(data, len);
+    this->tx_buffer_.consume(len);
+    this->timeoutSet(len * this->byte_time_);
+    // Marks and the end of the queued data always fall between commands
+    this->at_boundary_ = this->tx_buffer_.empty() || (!this->marks_.empty() && this->marks_.front().pos == pos + len);
+  }
+  if (!this->timeoutExpired() || (int32_t) (micros() - this->transfer_done_) < 0) {
+    this->paced_ = true;
+    this->paced_since_ = micros();
+  }
+  if (millis() - this->last_publish_ >= 1000)
+    this->publish_queue_metrics_();
+}
+
+void ThermalPrinterDisplay::update_status_() {
+  this->read_status_();
+  uint32_t now = millis();
+  if (this->status_received_ < 4 && now - this->status_sent_ >= STATUS_TIMEOUT) {
+    if (this->status_answered_ || this->status_hold_)
+      ESP_LOGW(TAG, "Printer didn't answer the status poll, pacing by estimate");
+    this->status_received_ = 4;
+    this->status_answered_ = false;
+    this->status_hold_ = false;
+  }
+  if (!this->at_boundary_)
     return;
+
+  if (this->status_received_ == 4 && now - this->status_sent_ >= this->status_interval_) {
+    this->send_status_query_(STATUS_POLL_CMD, sizeof(STATUS_POLL_CMD));
+    this->status_sent_ = now;
+    this->status_received_ = 0;
   }
+  // During a long pause, ask the printer to tell us when it has worked through its input buffer
+  if (this->status_answered_ && !dtrEnabled && !this->status_hold_ &&
+      (!this->idle_query_pending_ || now - this->idle_query_sent_ >= STATUS_TIMEOUT) &&
+      (int32_t) (resumeTime - micros()) > (int32_t) IDLE_QUERY_MIN_PAUSE) {
+    this->send_status_query_(IDLE_QUERY_CMD, sizeof(IDLE_QUERY_CMD));
+    this->idle_query_pending_ = true;
+    this->idle_query_sent_ = now;
+    this->idle_query_bytes_ = this->bytes_sent_;
+  }
+}
+
+// Status queries bypass send_(): they aren't part of any job or its metrics.
+void ThermalPrinterDisplay::send_status_query_(const uint8_t *data, size_t len) {
+  this->write_array(data, len);
+  uint32_t now = micros();
+  if ((int32_t) (this->transfer_done_ - now) < 0)
+    this->transfer_done_ = now;
+  this->transfer_done_ += len * this->byte_time_;
+}
+
+// DLE EOT replies have bits 1 and 4 set and bits 0 and 7 clear, the GS r 1 reply has bits 4 and 7 clear.
+void ThermalPrinterDisplay::read_status_() {
+  uint8_t c;
+  while (this->available() > 0 && this->read_byte(&c)) {
+    if ((c & 0x93) == 0x12 && this->status_received_ < 4) {
+      this->status_[this->status_received_++] = c;
+      if (this->status_received_ == 4)
+        this->apply_status_();
+    } else if ((c & 0x90) == 0 && this->idle_query_pending_) {
+      this->idle_query_pending_ = false;
+      if (this->bytes_sent_ == this->idle_query_bytes_ && !this->timeoutExpired()) {
+        ESP_LOGV(TAG, "Printer caught up %" PRId32 " us early", (int32_t) (resumeTime - micros()));
+        if (this->calibrating_)
+          this->add_calibration_sample_(micros());
+        resumeTime = micros();
+      }
+    } else {
+      ESP_LOGV(TAG, "Unexpected status byte 0x%02X", c);
+    }
+  }
+}
+
+void ThermalPrinterDisplay::apply_status_() {
+  bool offline = this->status_[0] & 0x08;
+  bool cover_open = this->status_[1] & 0x04;
+  bool paper_out = (this->status_[1] & 0x20) || (this->status_[3] & 0x60);
+  bool paper_near_end = this->status_[3] & 0x0C;
+  bool overheated = this->status_[2] & 0x40;  // Auto-recoverable error: head temperature or voltage
+  bool hold = paper_out || cover_open || overheated;
+  if (hold && !this->status_hold_) {
+    ESP_LOGW(TAG, "Printer can't print (%s%s%s), holding output", paper_out ? "paper out " : "",
+             cover_open ? "cover open " : "", overheated ? "head overheated " : "");
+  } else if (!hold && this->status_hold_) {
+    ESP_LOGI(TAG, "Printer can print again, resuming output");
+  }
+  ESP_LOGV(TAG, "Status %02X %02X %02X %02X%s", this->status_[0], this->status_[1], this->status_[2], this->status_[3],
+           offline ? ", offline" : "");
+  this->status_answered_ = true;
+  this->status_hold_ = hold;
+#ifdef USE_BINARY_SENSOR
+  if (this->paper_out_binary_sensor_ != nullptr)
+    this->paper_out_binary_sensor_->publish_state(paper_out);
+  if (this->paper_near_end_binary_sensor_ != nullptr)
+    this->paper_near_end_binary_sensor_->publish_state(paper_near_end);
+  if (this->cover_open_binary_sensor_ != nullptr)
+    this->cover_open_binary_sensor_->publish_state(cover_open);
+  if (this->overheated_binary_sensor_ != nullptr)
+    this->overheated_binary_sensor_->publish_state(overheated);
+#endif
+}
+
+void ThermalPrinterDisplay::start_job_() {
+  this->job_active_ = true;
+  this->job_start_ = millis();
+  this->job_bytes_ = 0;
+  this->job_estimate_ = 0;
+  this->paced_time_ = 0;
+}
 
-  std::vector<uint8_t> data = this->queue_.front();
-  this->queue_.pop();
-  this->write_array(data.data(), data.size());
+void ThermalPrinterDisplay::finish_job_() {
+  this->job_active_ = false;
+  this->jobs_completed_++;
+  uint32_t duration = millis() - this->job_start_;
+  ESP_LOGD(TAG, "Job %" PRIu32 " done: %" PRIu32 " bytes in %" PRIu32 " ms (estimated %" PRIu32 " ms, paced %" PRIu32
+           " ms)",
+           this->jobs_completed_, this->job_bytes_, duration, this->job_estimate_ / 1000, this->paced_time_ / 1000);
+  ESP_LOGD(TAG, "Job %" PRIu32 ": %" PRIu32 " redundant commands dropped, %" PRIu32 " queued writes sent in %" PRIu32
+           " UART writes",
+           this->jobs_completed_, this->job_commands_dropped_, this->job_pushes_, this->job_writes_);
+  this->job_commands_dropped_ = 0;
+  this->job_pushes_ = 0;
+  this->job_writes_ = 0;
+  this->publish_queue_metrics_();
+  if (this->print_job_active_) {
+    this->print_job_active_ = false;
+    this->job_complete_callback_.call();
+    if (this->jobs_.empty())
+      this->queue_empty_callback_.call();
+  }
+#ifdef USE_SENSOR
+  if (this->paced_time_sensor_ != nullptr)
+    this->paced_time_sensor_->publish_state(this->paced_time_ / 1000.0f);
+  if (this->job_duration_sensor_ != nullptr)
+    this->job_duration_sensor_->publish_state(duration);
+  if (this->job_estimated_duration_sensor_ != nullptr)
+    this->job_estimated_duration_sensor_->publish_state(this->job_estimate_ / 1000.0f);
+  if (this->jobs_completed_sensor_ != nullptr)
+    this->jobs_completed_sensor_->publish_state(this->jobs_completed_);
+#endif
+#ifdef USE_TEXT_SENSOR
+  if (this->last_job_text_sensor_ != nullptr) {
+    char buf[96];
+    snprintf(buf, sizeof(buf), "%" PRIu32 " bytes in %.1f s (estimated %.1f s, paced %.1f s)", this->job_bytes_,
+             duration / 1000.0f, this->job_estimate_ / 1e6f, this->paced_time_ / 1e6f);
+    this->last_job_text_sensor_->publish_state(buf);
+  }
+#endif
 }
 
-static uint16_t count = 0;
+// Counters that change while a job is running, published at most once a second and when a job ends.
+void ThermalPrinterDisplay::publish_queue_metrics_() {
+  this->last_publish_ = millis();
+#ifdef USE_SENSOR
+  if (this->bytes_sent_sensor_ != nullptr)
+    this->bytes_sent_sensor_->publish_state(this->bytes_sent_);
+  if (this->queue_depth_sensor_ != nullptr)
+    this->queue_depth_sensor_->publish_state(this->tx_buffer_.size());
+  if (this->queue_high_water_mark_sensor_ != nullptr)
+    this->queue_high_water_mark_sensor_->publish_state(this->tx_buffer_.high_water_mark());
+#endif
+}
 
 void ThermalPrinterDisplay::update() {
-  this->do_update_();
-  this->write_to_device_();
-  ESP_LOGD(TAG, "count: %d;", count);
-  count = 0;
+  if (!this->is_ready()) {
+    // Queued now, the page would go out ahead of the init sequence; print it once that is done
+    bool queued = std::any_of(this->jobs_.begin(), this->jobs_.end(),
+                              [](const PrintJob &job) { return job.type == PrintJob::PAGE; });
+    if (!queued) {
+      ESP_LOGD(TAG, "Printer not ready, deferring update");
+      this->enqueue_page();
+    }
+    return;
+  }
+  if (this->render_buffer_busy_()) {
+    ESP_LOGW(TAG, "Previous page is still printing, skipping update");
+    return;
+  }
+
+  if (this->get_buffer_rows_() >= this->height_) {
+    // Full-page mode renders right away; in banded mode the writer runs from loop() one band at a time
+    if (!this->page_prerendered_)
+      this->render_page_();
+    this->page_prerendered_ = false;
+  }
+
+  this->page_queued_ = true;
+  this->queue_mark_(TxMark::PAGE);
 }
 
-void ThermalPrinterDisplay::write_to_device_() {
+// Render the whole page into buffer_ (full-page mode).
+void ThermalPrinterDisplay::render_page_() {
+  uint32_t start = micros();
+  this->band_start_ = 0;
+  this->render_();
+  this->timing_test_ = false;
+  this->next_render_time_ = micros() - start;
+  ESP_LOGD(TAG, "Rendered page in %" PRIu32 "us", this->next_render_time_);
+}
+
+// Called when loop() reaches a page's PAGE mark. With double buffering, the rendered page moves to
+// send_buffer_ and the buffer the previous page went out of becomes the render target.
+void ThermalPrinterDisplay::begin_page_() {
+  this->page_queued_ = false;
+  this->page_sending_ = true;
+  this->page_row_ = 0;
+  this->band_start_ = 0;
+  this->band_rows_ = 0;
+  this->block_end_ = 0;
+  this->pending_feed_ = 0;
+  this->page_bytes_sent_ = 0;
+  this->render_time_ = 0;
+  if (this->get_buffer_rows_() >= this->height_) {
+    this->band_rows_ = this->height_;
+    this->render_time_ = this->next_render_time_;
+  }
+  if (this->double_buffer_) {
+    std::swap(this->buffer_, this->send_buffer_);
+    std::swap(this->dirty_min_, this->send_dirty_min_);
+    std::swap(this->dirty_max_, this->send_dirty_max_);
+  } else {
+    this->send_dirty_min_ = this->dirty_min_;
+    this->send_dirty_max_ = this->dirty_max_;
+  }
+}
+
+void ThermalPrinterDisplay::render_() {
+  if (this->timing_test_) {
+    this->draw_timing_test_();
+  } else if (this->banner_) {
+    this->run_writer_();
+    this->clear_dirty_();
+    this->transpose_strip_();
+  } else {
+    this->run_writer_();
+  }
+}
+
+// Display::do_update_() for the printer's own writer; pages and the test card still go through it.
+void ThermalPrinterDisplay::run_writer_() {
+  if (!this->writer_local_.has_value() || this->page_ != nullptr || this->show_test_card_) {
+    this->do_update_();
+    return;
+  }
+  if (this->auto_clear_enabled_)
+    this->clear();
+  (*this->writer_local_)(*this);
+  this->clear_clipping_();
+}
+
+// Render the band of page rows starting at band_start_ into buffer_.
+void ThermalPrinterDisplay::render_band_() {
+  uint32_t start = micros();
+  this->clear_dirty_();
+  this->render_();
+  this->band_rows_ = std::min(this->get_buffer_rows_(), this->height_ - this->band_start_);
+  this->send_dirty_min_ = this->dirty_min_;
+  this->send_dirty_max_ = this->dirty_max_;
+  uint32_t elapsed = micros() - start;
+  this->render_time_ += elapsed;
+  ESP_LOGD(TAG, "Rendered band %d in %" PRIu32 "us", this->band_start_, elapsed);
+}
+
+// Send the next piece of the current page, rendering the next band first when the current one has
+// been sent. Runs of blank rows are replaced by a paper feed, which splits the page into separate
+// GS v 0 raster blocks around them; blocks are further split to at most maxChunkHeight rows so
+// they fit the printer's input buffer. Returns true once the page is done.
+bool ThermalPrinterDisplay::send_page_() {
+  if (this->send_buffer_ == nullptr) {
+    return true;
+  }
+
+  if (this->page_row_ < this->block_end_) {
+    int rows =
+        std::min<int>(this->block_end_ - this->page_row_, std::max<size_t>(1, this->bytes_per_pass_() / ROW_BYTES));
+    size_t length = ROW_BYTES * rows;
+    if (this->page_row_ == this->block_end_ - this->block_rows_)
+      this->block_sent_ = micros();
+    this->send_(this->send_buffer_ + ROW_BYTES * (this->page_row_ - this->band_start_), length);
+    this->page_row_ += rows;
+    this->page_bytes_sent_ += length;
+
+    unsigned long d = length * this->byte_time_;
+    if (this->page_row_ == this->block_end_ && this->calibrating_) {
+      // Have the printer say when it's done; its reply cuts the wait short and times the block
+      this->send_status_query_(IDLE_QUERY_CMD, sizeof(IDLE_QUERY_CMD));
+      this->idle_query_pending_ = true;
+      this->idle_query_sent_ = millis();
+      this->idle_query_bytes_ = this->bytes_sent_;
+      d += 2 * this->block_time_ + STATUS_TIMEOUT * 1000UL;
+    } else if (this->page_row_ == this->block_end_) {
+      // The printer starts on the block once it has all of it, hold off the next one until it's done
+      d += this->block_time_;
+    }
+    this->timeoutSet(d);
+    return false;
+  }
+
+  if (this->page_row_ >= this->height_) {
+    // Trailing blank rows are cropped rather than fed
+    this->pending_feed_ = 0;
+    int32_t saved =
+        int32_t(sizeof(RASTER_HEADER_CMD) + ROW_BYTES * this->height_) - int32_t(this->page_bytes_sent_);
+    ESP_LOGD(TAG, "Page sent: %" PRIu32 " bytes, %" PRId32 " bytes saved by skipping blank rows",
+             this->page_bytes_sent_, saved);
+    return true;
+  }
+
+  int band_end = this->band_start_ + this->band_rows_;
+  if (this->page_row_ >= band_end) {
+    this->band_start_ = this->page_row_;
+    this->render_band_();
+    return false;
+  }
+
+  // A blank run is only worth skipping if its rows cost more than the feed and the extra header
+  int min_gap = (sizeof(RASTER_HEADER_CMD) + FEED_ROWS_CMD_SIZE) / ROW_BYTES + 1;
+  // Only rows inside the dirty span need to be looked at
+  int buffer_row = this->page_row_ - this->band_start_;
+  int blank = 0;
+  if (buffer_row > this->send_dirty_max_) {
+    blank = band_end - this->page_row_;
+  } else if (buffer_row < this->send_dirty_min_) {
+    blank = this->send_dirty_min_ - buffer_row;
+  } else {
+    while (this->page_row_ + blank < band_end && this->row_is_blank_(this->page_row_ + blank))
+      blank++;
+  }
+  if (blank >= min_gap || this->page_row_ + blank == band_end) {
+    this->pending_feed_ += blank;
+    this->page_row_ += blank;
+    return false;
+  }
+
+  // Extend the block up to the next blank run worth skipping, the end of the band or maxChunkHeight
+  int block_limit = std::min(band_end, this->page_row_ + std::max<int>(1, maxChunkHeight));
+  int end = this->page_row_ + 1;
+  int run = 0;
+  while (end < block_limit && run < min_gap) {
+    run = this->row_is_blank_(end) ? run + 1 : 0;
+    end++;
+  }
+  if (run >= min_gap && end - run > this->page_row_)
+    end -= run;
+
+  unsigned long d = this->write_feed_();
+  d += this->write_raster_header_(end - this->page_row_);
+  this->block_end_ = end;
+  this->block_rows_ = end - this->page_row_;
+  this->block_time_ = 0;
+  this->block_groups_ = 0;
+  for (int row = this->page_row_; row < end; row++) {
+    uint16_t dots = this->row_dots_(row);
+    this->block_time_ += this->rowTime(dots);
+    this->block_groups_ += this->dot_groups_(dots);
+  }
+  this->timeoutSet(d);
+  return false;
+}
+
+uint16_t ThermalPrinterDisplay::row_dots_(int page_row) {
+  const uint8_t *row = this->send_buffer_ + ROW_BYTES * (page_row - this->band_start_);
+  uint16_t dots = 0;
+  for (size_t i = 0; i < ROW_BYTES; i++)
+    dots += __builtin_popcount(row[i]);
+  return dots;
+}
+
+bool ThermalPrinterDisplay::row_is_blank_(int page_row) {
+  const uint8_t *row = this->send_buffer_ + ROW_BYTES * (page_row - this->band_start_);
+  for (size_t i = 0; i < ROW_BYTES; i++) {
+    if (row[i] != 0)
+      return false;
+  }
+  return true;
+}
+
+// Send the GS v 0 header announcing a raster block of the given number of rows. Returns the time
+// it takes to transfer.
+unsigned long ThermalPrinterDisplay::write_raster_header_(uint16_t rows) {
+  uint8_t header[sizeof(RASTER_HEADER_CMD)];
+  fill_raster_header(header, ROW_BYTES, rows);
+
+  this->send_(header, sizeof(header));
+  this->page_bytes_sent_ += sizeof(header);
+  return sizeof(header) * this->byte_time_;
+}
+
+// Feed the paper past the blank rows skipped so far (ESC J n). Returns the time it takes.
+unsigned long ThermalPrinterDisplay::write_feed_() {
+  unsigned long d = 0;
+  while (this->pending_feed_ > 0) {
+    uint8_t n = std::min(this->pending_feed_, 255);
+    uint8_t feed_arr[FEED_ROWS_CMD_SIZE] = {ASCII_ESC, 'J', n};
+    this->send_(feed_arr, sizeof(feed_arr));
+    this->page_bytes_sent_ += sizeof(feed_arr);
+    this->pending_feed_ -= n;
+    d += sizeof(feed_arr) * this->byte_time_ + n * dotFeedTime;
+  }
+  return d;
+}
+
+void ThermalPrinterDisplay::fill(Color color) {
   if (this->buffer_ == nullptr) {
     return;
   }
+  if (this->banner_) {
+    this->fill_strip_(this->band_start_, 0, this->band_start_ + this->get_buffer_rows_(), PAPER_WIDTH, color.is_on());
+    return;
+  }
+  if (!color.is_on()) {
+    this->clear_dirty_();
+    return;
+  }
+  memset(this->buffer_, 0xFF, this->get_buffer_length_());
+  this->mark_dirty_(0, this->get_buffer_rows_() - 1);
+}
 
-  uint8_t header[] = {0x1D, 0x76, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00};
+// Clear only the rows that have been drawn to since the last clear.
+void ThermalPrinterDisplay::clear_dirty_() {
+  if (this->buffer_ == nullptr || this->dirty_min_ > this->dirty_max_) {
+    return;
+  }
+  memset(this->buffer_ + ROW_BYTES * this->dirty_min_, 0x00, ROW_BYTES * (this->dirty_max_ - this->dirty_min_ + 1));
+  this->dirty_min_ = INT32_MAX;
+  this->dirty_max_ = -1;
+}
 
-  uint16_t width = this->get_width() / 8;
-  uint16_t height = this->get_height();
+// The line and rectangle primitives below write the 1bpp buffer (or in banner mode the strip) a byte
+// at a time instead of going through draw_absolute_pixel_internal() per pixel. They fall back to the
+// generic implementation when the display is otherwise rotated.
+void ThermalPrinterDisplay::horizontal_line(int x, int y, int width, Color color) {
+  this->filled_rectangle(x, y, width, 1, color);
+}
 
-  header[3] = 0;  // Mode
-  header[4] = width & 0xFF;
-  header[5] = (width >> 8) & 0xFF;
-  header[6] = height & 0xFF;
-  header[7] = (height >> 8) & 0xFF;
+void ThermalPrinterDisplay::vertical_line(int x, int y, int height, Color color) {
+  this->filled_rectangle(x, y, 1, height, color);
+}
 
-  this->queue_data_(header, sizeof(header));
-  this->queue_data_(this->buffer_, this->get_buffer_length_());
+void ThermalPrinterDisplay::filled_rectangle(int x1, int y1, int width, int height, Color color) {
+  if (this->rotation_ != display::DISPLAY_ROTATION_0_DEGREES && !this->banner_) {
+    display::DisplayBuffer::filled_rectangle(x1, y1, width, height, color);
+    return;
+  }
+  int x2 = x1 + width;
+  int y2 = y1 + height;
+  if (this->is_clipping()) {
+    display::Rect clip = this->get_clipping();
+    x1 = std::max<int>(x1, clip.x);
+    y1 = std::max<int>(y1, clip.y);
+    x2 = std::min<int>(x2, clip.x + clip.w);
+    y2 = std::min<int>(y2, clip.y + clip.h);
+  }
+  if (this->banner_) {
+    this->fill_strip_(x1, y1, x2, y2, color.is_on());
+    return;
+  }
+  this->fill_rect_internal_(x1, y1, x2, y2, color.is_on());
+}
+
+// Set or clear bits [x1, x2) of rows [y1, y2) of a 1bpp buffer with `stride` bytes per row, MSB
+// first, whole bytes at a time. The area must lie inside the buffer.
+static void fill_bits(uint8_t *buffer, size_t stride, int x1, int y1, int x2, int y2, bool on) {
+  int first = x1 / 8;
+  int last = (x2 - 1) / 8;
+  uint8_t first_mask = 0xFF >> (x1 % 8);
+  uint8_t last_mask = 0xFF << (7 - (x2 - 1) % 8);
+  if (first == last) {
+    first_mask &= last_mask;
+  }
+
+  uint8_t *row = buffer + stride * y1;
+  for (int y = y1; y < y2; y++, row += stride) {
+    if (on) {
+      row[first] |= first_mask;
+      if (last > first) {
+        memset(row + first + 1, 0xFF, last - first - 1);
+        row[last] |= last_mask;
+      }
+    } else {
+      row[first] &= ~first_mask;
+      if (last > first) {
+        memset(row + first + 1, 0x00, last - first - 1);
+        row[last] &= ~last_mask;
+      }
+    }
+  }
+}
+
+// Set or clear the pixels in [x1, x2) x [y1, y2) of the page, limited to the page and the current band.
+void ThermalPrinterDisplay::fill_rect_internal_(int x1, int y1, int x2, int y2, bool on) {
+  if (this->buffer_ == nullptr) {
+    return;
+  }
+  x1 = std::max(x1, 0);
+  x2 = std::min(x2, this->get_width_internal());
+  y1 = std::max(y1 - this->band_start_, 0);
+  y2 = std::min(y2 - this->band_start_, this->get_buffer_rows_());
+  if (x1 >= x2 || y1 >= y2) {
+    return;
+  }
+  fill_bits(this->buffer_, ROW_BYTES, x1, y1, x2, y2, on);
+  if (on) {
+    this->mark_dirty_(y1, y2 - 1);
+  }
+}
+
+// Banner mode: set or clear the pixels in [x1, x2) x [y1, y2) of the landscape page, limited to the
+// page and the current band. Only strip rows that have been drawn to are cleared.
+void ThermalPrinterDisplay::fill_strip_(int x1, int y1, int x2, int y2, bool on) {
+  x1 = std::max(x1 - this->band_start_, 0);
+  x2 = std::min(std::min(x2, this->height_) - this->band_start_, this->get_buffer_rows_());
+  y1 = std::max(y1, 0);
+  y2 = std::min(y2, PAPER_WIDTH);
+  if (!on) {
+    y1 = std::max(y1, this->strip_dirty_min_);
+    y2 = std::min(y2, this->strip_dirty_max_ + 1);
+  }
+  if (x1 >= x2 || y1 >= y2) {
+    return;
+  }
+  fill_bits(this->strip_, this->strip_stride_, x1, y1, x2, y2, on);
+  if (on) {
+    this->strip_dirty_min_ = std::min(this->strip_dirty_min_, y1);
+    this->strip_dirty_max_ = std::max(this->strip_dirty_max_, y2 - 1);
+  }
+}
+
+// Turn the strip into printer rows in buffer_ and clear it for the next band. Page column x becomes
+// printer row x and page row y printer dot PAPER_WIDTH - 1 - y, as DisplayBuffer rotates by 90
+// degrees. That is a transpose of the strip read bottom row first, done on 8x8 blocks: the 8 strip
+// bytes of a block become the 8 bytes of one printer byte column in 8 consecutive rows. Blocks outside
+// the strip's dirty rows and blank blocks are left out, buffer_ is clear already.
+void ThermalPrinterDisplay::transpose_strip_() {
+  if (this->buffer_ == nullptr || this->strip_dirty_min_ > this->strip_dirty_max_) {
+    return;
+  }
+  int rows = std::min(this->get_buffer_rows_(), this->height_ - this->band_start_);
+  size_t stride = this->strip_stride_;
+  int first_row = INT32_MAX, last_row = -1;
+  for (int block = this->strip_dirty_min_ / 8; block <= this->strip_dirty_max_ / 8; block++) {
+    const uint8_t *bottom = this->strip_ + stride * (8 * block + 7);
+    uint8_t *column = this->buffer_ + (ROW_BYTES - 1 - block);
+    for (size_t bx = 0; bx < stride; bx++) {
+      uint64_t x = 0;
+      const uint8_t *in = bottom + bx;
+      for (int i = 0; i < 8; i++, in -= stride)
+        x = (x << 8) | *in;
+      if (x == 0)
+        continue;
+      x = transpose_8x8(x);
+      int row = 8 * bx;
+      int n = std::min(8, rows - row);
+      uint8_t *out = column + ROW_BYTES * row;
+      for (int j = 0; j < n; j++, out += ROW_BYTES)
+        *out = x >> (56 - 8 * j);
+      first_row = std::min(first_row, row);
+      last_row = std::max(last_row, row + n - 1);
+    }
+  }
+  if (last_row >= first_row)
+    this->mark_dirty_(first_row, last_row);
+
+  memset(this->strip_ + stride * this->strip_dirty_min_, 0,
+         stride * (this->strip_dirty_max_ - this->strip_dirty_min_ + 1));
+  this->strip_dirty_min_ = INT32_MAX;
+  this->strip_dirty_max_ = -1;
+}
+
+// Banner mode takes pixels in page coordinates straight into the strip; otherwise they go through
+// DisplayBuffer's rotation to draw_absolute_pixel_internal(). Glyphs being cached are captured as
+// drawn, unrotated.
+void ThermalPrinterDisplay::draw_pixel_at(int x, int y, Color color) {
+  if (this->glyph_capture_ != nullptr) {
+    if (color.is_on())
+      this->glyph_capture_->emplace_back(x, y);
+    return;
+  }
+  if (!this->banner_) {
+    display::DisplayBuffer::draw_pixel_at(x, y, color);
+    return;
+  }
+  if (!this->get_clipping().inside(x, y))
+    return;
+  x -= this->band_start_;
+  if (x < 0 || x >= this->get_buffer_rows_() || x >= this->height_ - this->band_start_ || y < 0 || y >= PAPER_WIDTH)
+    return;
+  uint8_t *byte = this->strip_ + this->strip_stride_ * y + x / 8;
+  if (color.is_on()) {
+    *byte |= 0x80 >> (x % 8);
+    this->strip_dirty_min_ = std::min(this->strip_dirty_min_, y);
+    this->strip_dirty_max_ = std::max(this->strip_dirty_max_, y);
+  } else {
+    *byte &= ~(0x80 >> (x % 8));
+  }
+}
+
+// Number of bytes in the UTF-8 sequence starting with `c`.
+static size_t utf8_length(uint8_t c) {
+  if (c >= 0xF0)
+    return 4;
+  if (c >= 0xE0)
+    return 3;
+  if (c >= 0xC0)
+    return 2;
+  return 1;
+}
+
+// Code point of the UTF-8 sequence of `length` bytes at `text`.
+static uint32_t utf8_decode(const char *text, size_t length) {
+  uint32_t code = uint8_t(text[0]) & (length == 1 ? 0x7F : 0xFF >> (length + 1));
+  for (size_t i = 1; i < length; i++)
+    code = (code << 6) | (uint8_t(text[i]) & 0x3F);
+  return code;
+}
+
+void ThermalPrinterDisplay::print_cached(int x, int y, display::BaseFont *font, Color color, display::TextAlign align,
+                                         const char *text) {
+  if (this->rotation_ != display::DISPLAY_ROTATION_0_DEGREES || this->is_clipping()) {
+    this->print(x, y, font, color, align, text);
+    return;
+  }
+
+  int x_start, y_start, width, height;
+  this->get_text_bounds(x, y, text, font, align, &x_start, &y_start, &width, &height);
+
+  while (*text != '\0') {
+    size_t length = std::min(utf8_length(*text), strlen(text));
+    const CachedGlyph &glyph = this->get_cached_glyph_(font, text, length);
+    this->blit_glyph_(glyph, x_start, y_start, color.is_on());
+    x_start += glyph.advance;
+    text += length;
+  }
+}
+
+// Look up the glyph for the character at `text`, rasterizing it through the font on first use by
+// capturing the pixels the font draws.
+const ThermalPrinterDisplay::CachedGlyph &ThermalPrinterDisplay::get_cached_glyph_(display::BaseFont *font,
+                                                                                   const char *text, size_t length) {
+  uint32_t code = 0;
+  for (size_t i = 0; i < length; i++)
+    code = (code << 8) | uint8_t(text[i]);
+  auto key = std::make_pair(font, code);
+  auto it = this->glyph_cache_.find(key);
+  if (it != this->glyph_cache_.end()) {
+    return it->second;
+  }
+
+  std::string character(text, length);
+  std::vector<std::pair<int16_t, int16_t>> pixels;
+  this->glyph_capture_ = &pixels;
+  font->print(0, 0, this, display::COLOR_ON, character.c_str(), display::COLOR_OFF);
+  this->glyph_capture_ = nullptr;
+
+  int width, x_offset, baseline, height;
+  font->measure(character.c_str(), &width, &x_offset, &baseline, &height);
+
+  CachedGlyph glyph{};
+  glyph.advance = width + x_offset;
+  if (!pixels.empty()) {
+    int16_t x_min = INT16_MAX, y_min = INT16_MAX, x_max = INT16_MIN, y_max = INT16_MIN;
+    for (auto &pixel : pixels) {
+      x_min = std::min(x_min, pixel.first);
+      x_max = std::max(x_max, pixel.first);
+      y_min = std::min(y_min, pixel.second);
+      y_max = std::max(y_max, pixel.second);
+    }
+    glyph.x_offset = x_min;
+    glyph.y_offset = y_min;
+    glyph.width = x_max - x_min + 1;
+    glyph.height = y_max - y_min + 1;
+    size_t stride = (glyph.width + 7) / 8;
+    glyph.bitmap.resize(stride * glyph.height);
+    for (auto &pixel : pixels) {
+      int gx = pixel.first - x_min;
+      glyph.bitmap[stride * (pixel.second - y_min) + gx / 8] |= 0x80 >> (gx % 8);
+    }
+  }
+  return this->glyph_cache_.emplace(key, std::move(glyph)).first->second;
+}
+
+// OR (or clear) a cached glyph into the buffer with its origin at page position (x, y), shifting
+// whole glyph bytes into place.
+void ThermalPrinterDisplay::blit_glyph_(const CachedGlyph &glyph, int x, int y, bool on) {
+  if (this->buffer_ == nullptr || glyph.bitmap.empty()) {
+    return;
+  }
+  int stride = ROW_BYTES;
+  int glyph_stride = (glyph.width + 7) / 8;
+  x += glyph.x_offset;
+  y += glyph.y_offset - this->band_start_;
+  int shift = x & 7;
+  int first_byte = x >> 3;  // Arithmetic shift, so this rounds down for negative x
+
+  int r_start = std::max(0, -y);
+  int r_end = std::min<int>(glyph.height, this->get_buffer_rows_() - y);
+  if (r_start >= r_end) {
+    return;
+  }
+  for (int r = r_start; r < r_end; r++) {
+    uint8_t *row = this->buffer_ + size_t(stride) * (y + r);
+    const uint8_t *src = glyph.bitmap.data() + size_t(glyph_stride) * r;
+    for (int i = 0; i < glyph_stride; i++) {
+      int index = first_byte + i;
+      uint8_t hi = src[i] >> shift;
+      uint8_t lo = shift == 0 ? 0 : uint8_t(src[i] << (8 - shift));
+      if (index >= 0 && index < stride) {
+        row[index] = on ? row[index] | hi : row[index] & ~hi;
+      }
+      if (lo != 0 && index + 1 >= 0 && index + 1 < stride) {
+        row[index + 1] = on ? row[index + 1] | lo : row[index + 1] & ~lo;
+      }
+    }
+  }
+  if (on) {
+    this->mark_dirty_(y + r_start, y + r_end - 1);
+  }
 }
 
 void ThermalPrinterDisplay::draw_absolute_pixel_internal(int x, int y, Color color) {
@@ -578,15 +2356,266 @@ void ThermalPrinterDisplay::draw_absolute_pixel_internal(int x, int y, Color col
     ESP_LOGW(TAG, "Invalid pixel: x=%d, y=%d", x, y);
     return;
   }
-  uint8_t width = this->get_width_internal() / 8;
-  uint16_t index = x / 8 + y * width;
+  // Pixels outside the band currently being rendered are dropped silently
+  y -= this->band_start_;
+  if (y < 0 || y >= this->get_buffer_rows_()) {
+    return;
+  }
+  // 32-bit index: a 576 dot wide page passes 64 KiB after 910 rows
+  size_t index = ROW_BYTES * y + x / 8;
   uint8_t bit = x % 8;
   if (color.is_on()) {
     this->buffer_[index] |= 1 << (7 - bit);
+    this->mark_dirty_(y, y);
   } else {
     this->buffer_[index] &= ~(1 << (7 - bit));
   }
-  count++;
+}
+
+// Split the receipt into printer lines, each receipt line as text if the selected code page has all
+// its characters, else as raster through the receipt font. Text takes a few bytes per line where
+// raster takes a full row of bytes per dot row, so raster is only used where it has to be. The
+// estimated time of the result is logged: the longer of transfer and print time for each line, as
+// the printer prints while it receives. Both kinds of line are timed with rowTime(), the printer
+// heats the dots of its own characters just as it does those of a raster row.
+void ThermalPrinterDisplay::plan_receipt_(const std::vector<ReceiptLine> &lines) {
+  unsigned text_rows = 0, raster_rows = 0;
+  size_t text_bytes = 0, raster_bytes = 0;
+  unsigned long estimate = 0;
+  // Text blackens about an eighth of the dots in its rows
+  unsigned long dot_row_time = this->rowTime(PAPER_WIDTH / 8);
+  this->job_receipt_.clear();
+  for (const ReceiptLine &line : lines) {
+    std::string text = line.text;
+    if (!text.empty() && text.back() == '\n')
+      text.pop_back();
+    std::string encoded;
+    bool encodable = this->encode_receipt_text_(text, encoded);
+
+    if (!encodable && this->receipt_font_ != nullptr) {
+      int width, x_offset, baseline, height;
+      this->receipt_font_->measure(text.c_str(), &width, &x_offset, &baseline, &height);
+      if (line.style & RECEIPT_DOUBLE_HEIGHT)
+        height *= 2;
+      size_t row_bytes = sizeof(RASTER_HEADER_CMD) + ROW_BYTES * height;
+      unsigned long row_time = height * dot_row_time + lineSpacing * dotFeedTime;
+      for (auto &row : this->wrap_raster_text_(text, line.style)) {
+        this->job_receipt_.push_back(ReceiptRow{true, line.style, line.align, std::move(row)});
+        estimate += std::max<unsigned long>(row_bytes * this->byte_time_, row_time);
+        raster_bytes += row_bytes;
+        raster_rows++;
+      }
+      continue;
+    }
+    if (!encodable) {
+      ESP_LOGW(TAG, "Code page %u lacks characters of \"%s\" and there is no receipt font", this->code_page_,
+               text.c_str());
+    }
+
+    int char_width = (line.style & RECEIPT_DOUBLE_WIDTH) ? 24 : 12;
+    int char_height = (line.style & RECEIPT_DOUBLE_HEIGHT) ? 48 : 24;
+    unsigned long row_time = char_height * dot_row_time + lineSpacing * dotFeedTime;
+    for (auto &row : wrap_text(encoded + '\n', 0, PAPER_WIDTH / char_width)) {
+      estimate += std::max<unsigned long>(row.size() * this->byte_time_, row_time);
+      text_bytes += row.size();
+      text_rows++;
+      this->job_receipt_.push_back(ReceiptRow{false, line.style, line.align, std::move(row)});
+    }
+  }
+  ESP_LOGD(TAG, "Receipt of %u lines: %u printer lines as text (%u bytes), %u as raster (about %u bytes), about %lu ms",
+           (unsigned) lines.size(), text_rows, (unsigned) text_bytes, raster_rows, (unsigned) raster_bytes,
+           estimate / 1000);
+}
+
+// Encode UTF-8 text in the selected code page. Characters it doesn't have become '?' and make this
+// return false.
+bool ThermalPrinterDisplay::encode_receipt_text_(const std::string &text, std::string &encoded) {
+  bool complete = true;
+  encoded.clear();
+  encoded.reserve(text.size());
+  const char *p = text.c_str();
+  while (*p != '\0') {
+    size_t length = std::min(utf8_length(*p), strlen(p));
+    uint32_t code = utf8_decode(p, length);
+    p += length;
+    if (code == '\n' || code == '\r') {
+      encoded += char(code);
+      continue;
+    }
+    uint8_t c = encode_code_point(this->code_page_, code);
+    if (c == 0) {
+      c = '?';
+      complete = false;
+    }
+    encoded += char(c);
+  }
+  return complete;
+}
+
+// Split text into raster lines that fit the paper in the receipt font, breaking at spaces. A word
+// wider than the paper gets a line of its own and is cut off.
+std::vector<std::string> ThermalPrinterDisplay::wrap_raster_text_(const std::string &text, uint8_t style) {
+  int scale = (style & RECEIPT_DOUBLE_WIDTH) ? 2 : 1;
+  auto fits = [this, scale](const std::string &line) {
+    int width, x_offset, baseline, height;
+    this->receipt_font_->measure(line.c_str(), &width, &x_offset, &baseline, &height);
+    return (x_offset + width) * scale <= PAPER_WIDTH;
+  };
+
+  std::vector<std::string> lines;
+  size_t start = 0;
+  do {
+    size_t end = std::min(text.find('\n', start), text.size());
+    std::string line;
+    size_t pos = start;
+    while (true) {
+      size_t space = std::min(text.find(' ', pos), end);
+      std::string word = text.substr(pos, space - pos);
+      std::string candidate = line.empty() ? word : line + ' ' + word;
+      if (!line.empty() && !fits(candidate)) {
+        lines.push_back(line);
+        line = word;
+      } else {
+        line = candidate;
+      }
+      if (space == end)
+        break;
+      pos = space + 1;
+    }
+    lines.push_back(line);
+    start = end + 1;
+  } while (start <= text.size());
+  return lines;
+}
+
+// Queue the next planned receipt line: set the printer up for it and queue the text, or render it
+// for queue_raster_rows_().
+void ThermalPrinterDisplay::start_receipt_row_(const ReceiptRow &row) {
+  if (row.raster) {
+    this->render_receipt_row_(row);
+    return;
+  }
+  this->setCodePage(this->code_page_);
+  this->setLineHeight(24 + lineSpacing);  // ESC @ has put the printer back to its own
+  this->justify(row.align);
+  printMode = (printMode & ~RECEIPT_PRINT_MODE_MASK) | (row.style & RECEIPT_PRINT_MODE_MASK);
+  writePrintMode();
+  adjustCharValues(printMode);
+  if (row.style & RECEIPT_UNDERLINE) {
+    this->queue_setting_(SETTING_UNDERLINE, UNDERLINE_ON_CMD, sizeof(UNDERLINE_ON_CMD));
+  } else {
+    this->underlineOff();
+  }
+  column = 0;
+  if (!this->queue_text_line_(row.data))
+    ESP_LOGW(TAG, "Line of %u bytes doesn't fit the transmit buffer, dropping it", (unsigned) row.data.size());
+}
+
+// Render a raster receipt line into job_raster_ the way the printer prints text in that style:
+// double width and height scale the glyphs, bold repeats every dot to its right and underline rules
+// the row below the baseline. Blank rows above the text are fed right away, those below once the
+// rest has been printed.
+void ThermalPrinterDisplay::render_receipt_row_(const ReceiptRow &row) {
+  display::BaseFont *font = this->receipt_font_;
+  int x_scale = (row.style & RECEIPT_DOUBLE_WIDTH) ? 2 : 1;
+  int y_scale = (row.style & RECEIPT_DOUBLE_HEIGHT) ? 2 : 1;
+  int dot_width = (row.style & RECEIPT_BOLD) ? 2 * x_scale : x_scale;
+
+  int width, x_offset, baseline, height;
+  font->measure(row.data.c_str(), &width, &x_offset, &baseline, &height);
+  int rows = height * y_scale;
+  int line_width = (x_offset + width) * x_scale + dot_width - x_scale;
+  int x = 0;
+  if (toupper(row.align) == 'C') {
+    x = std::max((PAPER_WIDTH - line_width) / 2, 0);
+  } else if (toupper(row.align) == 'R') {
+    x = std::max(PAPER_WIDTH - line_width, 0);
+  }
+
+  this->job_raster_.assign(ROW_BYTES * rows, 0);
+  uint8_t *raster = this->job_raster_.data();
+  auto fill = [raster, rows](int x1, int y1, int w, int h) {
+    for (int y = std::max(y1, 0); y < std::min(y1 + h, rows); y++) {
+      for (int dx = std::max(x1, 0); dx < std::min(x1 + w, PAPER_WIDTH); dx++)
+        raster[ROW_BYTES * y + dx / 8] |= 0x80 >> (dx % 8);
+    }
+  };
+
+  int line_x = x;
+  const char *text = row.data.c_str();
+  while (*text != '\0') {
+    size_t length = std::min(utf8_length(*text), strlen(text));
+    const CachedGlyph &glyph = this->get_cached_glyph_(font, text, length);
+    size_t stride = (glyph.width + 7) / 8;
+    for (int gy = 0; gy < glyph.height; gy++) {
+      for (int gx = 0; gx < glyph.width; gx++) {
+        if (glyph.bitmap[stride * gy + gx / 8] & (0x80 >> (gx % 8)))
+          fill(x + (glyph.x_offset + gx) * x_scale, (glyph.y_offset + gy) * y_scale, dot_width, y_scale);
+      }
+    }
+    x += glyph.advance * x_scale;
+    text += length;
+  }
+  if (row.style & RECEIPT_UNDERLINE)
+    fill(line_x, std::min(baseline + 1, height - 1) * y_scale, line_width, y_scale);
+
+  auto blank = [raster](int y) {
+    const uint8_t *r = raster + ROW_BYTES * y;
+    return std::all_of(r, r + ROW_BYTES, [](uint8_t b) { return b == 0; });
+  };
+  int first = 0;
+  while (first < rows && blank(first))
+    first++;
+  int last = rows;
+  while (last > first && blank(last - 1))
+    last--;
+  this->queue_feed_rows_(first);
+  this->job_raster_row_ = first;
+  this->job_raster_end_ = last;
+}
+
+// Queue the next rows of the rendered receipt line as GS v 0 blocks, as many as fit the transmit
+// buffer, then feed past its blank rows and the line spacing. Returns false if it has to wait for room.
+// A line whose rows can never fit is dropped.
+bool ThermalPrinterDisplay::queue_raster_rows_() {
+  if (this->job_raster_row_ < this->job_raster_end_ &&
+      sizeof(RASTER_HEADER_CMD) + ROW_BYTES > this->tx_buffer_.capacity()) {
+    ESP_LOGW(TAG, "Raster row of %u bytes doesn't fit the transmit buffer, dropping the line", (unsigned) ROW_BYTES);
+    this->tx_dropped_ += (this->job_raster_end_ - this->job_raster_row_) * ROW_BYTES;
+    this->job_raster_row_ = this->job_raster_end_;
+  }
+  while (this->job_raster_row_ < this->job_raster_end_) {
+    int rows = std::min<int>(this->job_raster_end_ - this->job_raster_row_, maxChunkHeight);
+    // As for images, wait for room for a block of at least half the transmit buffer
+    int half = (this->tx_buffer_.capacity() / 2 - sizeof(RASTER_HEADER_CMD)) / ROW_BYTES;
+    int wanted = std::min(rows, std::max(half, 1));
+    size_t free = this->tx_buffer_.free();
+    if (free <= sizeof(RASTER_HEADER_CMD))
+      return false;
+    rows = std::min<int>(rows, (free - sizeof(RASTER_HEADER_CMD)) / ROW_BYTES);
+    if (rows < wanted)
+      return false;
+
+    uint8_t header[sizeof(RASTER_HEADER_CMD)];
+    fill_raster_header(header, ROW_BYTES, rows);
+    this->queue_data_(header, sizeof(header));
+    const uint8_t *data = this->job_raster_.data() + ROW_BYTES * this->job_raster_row_;
+    this->queue_data_(data, ROW_BYTES * rows);
+    unsigned long d = 0;
+    for (int y = 0; y < rows; y++) {
+      uint16_t dots = 0;
+      for (size_t i = 0; i < ROW_BYTES; i++)
+        dots += __builtin_popcount(data[ROW_BYTES * y + i]);
+      d += this->rowTime(dots);
+    }
+    this->queue_pause_(d);
+    this->job_raster_row_ += rows;
+  }
+  if (this->tx_buffer_.free() < 2 * FEED_ROWS_CMD_SIZE)
+    return false;
+  this->queue_feed_rows_(this->job_raster_.size() / ROW_BYTES - this->job_raster_end_ + lineSpacing);
+  this->job_raster_.clear();
+  return true;
 }
 
 }  // namespace thermal_printer
@@ -1,14 +1,42 @@
 #pragma once
 
+#include "esphome/core/automation.h"
+#include "esphome/core/defines.h"
+#include "esphome/core/gpio.h"
 #include "esphome/core/helpers.h"
+#include "esphome/core/preferences.h"
 
 #include "esphome/components/display/display_buffer.h"
+#include "esphome/components/image/image.h"
 #include "esphome/components/uart/uart.h"
+#ifdef USE_BINARY_SENSOR
+#include "esphome/components/binary_sensor/binary_sensor.h"
+#endif
+#ifdef USE_SENSOR
+#include "esphome/components/sensor/sensor.h"
+#endif
+#ifdef USE_TEXT_SENSOR
+#include "esphome/components/text_sensor/text_sensor.h"
+#endif
 
+#include "dither.h"
+#include "transpose.h"
+#include "tx_ring_buffer.h"
+
+#include <algorithm>
 #include <cinttypes>
+#include <deque>
+#include <functional>
+#include <map>
 #include <queue>
+#include <utility>
 #include <vector>
 
+// Printable width in dots, set by the paper_width option: 384 for 58mm paper, 576 for 80mm paper
+#ifndef THERMAL_PRINTER_PAPER_WIDTH
+#define THERMAL_PRINTER_PAPER_WIDTH 384
+#endif
+
 namespace esphome {
 namespace thermal_printer {
 
@@ -24,10 +52,77 @@ enum BarcodeType {
   CODE128,
 };
 
+// Style of a receipt line. Bold and the double sizes are the printer's ESC ! print mode bits.
+enum ReceiptStyle : uint8_t {
+  RECEIPT_BOLD = 1 << 3,
+  RECEIPT_DOUBLE_HEIGHT = 1 << 4,
+  RECEIPT_DOUBLE_WIDTH = 1 << 5,
+  RECEIPT_UNDERLINE = 1 << 7,  // ESC -
+};
+
+// A line of a receipt, UTF-8. Wrapped to the paper width when too long.
+struct ReceiptLine {
+  std::string text;
+  uint8_t style{0};  // ReceiptStyle bits
+  char align{'L'};   // L, C or R, as for justify()
+};
+
+// A queued print job. Jobs with a higher priority go first, jobs of equal priority in order.
+struct PrintJob {
+  enum Type : uint8_t {
+    TEXT,     // print_text(text, font_size)
+    PAGE,     // Render and print the display page
+    FEED,     // Feed `lines` lines
+    QRCODE,   // print_qrcode(text)
+    BARCODE,  // print_barcode(text, barcode_type)
+    IMAGE,    // Stream `image` as raster, dithered with `dither`
+    RECEIPT,  // Print `receipt`, each line as text or raster
+  };
+  Type type;
+  uint8_t priority{0};
+  uint8_t font_size{0};  // Characters font_size + 1 times as wide and high, up to 7
+  uint8_t lines{0};
+  uint8_t barcode_type{0};
+  DitherMode dither{DITHER_FLOYD_STEINBERG};
+  std::string text{};
+  image::Image *image{nullptr};
+  std::vector<ReceiptLine> receipt{};
+};
+
+class ThermalPrinterDisplay;
+using thermal_printer_writer_t = std::function<void(ThermalPrinterDisplay &)>;
+
 class ThermalPrinterDisplay : public display::DisplayBuffer, public uart::UARTDevice {
+ public:
+  // Dots per row and bytes per row of the page buffer and of raster data
+  static constexpr int PAPER_WIDTH = THERMAL_PRINTER_PAPER_WIDTH;
+  static constexpr size_t ROW_BYTES = PAPER_WIDTH / 8;
+  static_assert(PAPER_WIDTH % 8 == 0, "Paper width must be a whole number of bytes");
+
+#ifdef USE_SENSOR
+  SUB_SENSOR(bytes_sent)
+  SUB_SENSOR(queue_depth)
+  SUB_SENSOR(queue_high_water_mark)
+  SUB_SENSOR(render_time)
+  SUB_SENSOR(paced_time)
+  SUB_SENSOR(job_duration)
+  SUB_SENSOR(job_estimated_duration)
+  SUB_SENSOR(jobs_completed)
+#endif
+#ifdef USE_TEXT_SENSOR
+  SUB_TEXT_SENSOR(last_job)
+#endif
+#ifdef USE_BINARY_SENSOR
+  SUB_BINARY_SENSOR(paper_out)
+  SUB_BINARY_SENSOR(paper_near_end)
+  SUB_BINARY_SENSOR(cover_open)
+  SUB_BINARY_SENSOR(overheated)
+#endif
+
  public:
   void setup() override;
   void loop() override;
+  void dump_config() override;
   void update() override;
 
   void begin();
@@ -54,51 +149,398 @@ class ThermalPrinterDisplay : public display::DisplayBuffer, public uart::UARTDe
   void setCharset(uint8_t val = 0);
   void setCodePage(uint8_t val = 0);
   void feed(uint8_t x);
-  void timeoutWait();
-  void write_to_device_();
+  void upgradeBaudRate();
+  bool timeoutExpired();
+  unsigned long rowTime(uint16_t dots);
+
+  // Raster timing calibration, persisted across reboots. Coefficients from the config replace the
+  // saved ones at boot.
+  void set_config_timing(uint32_t row_time, uint16_t heat_scale) {
+    this->config_timing_ = TimingCoefficients{row_time, heat_scale};
+  }
+  void set_timing_coefficients(uint32_t row_time, uint16_t heat_scale);
+  void print_timing_test();
+  // Print the timing test and fit the coefficients to how long the printer takes over each band, as
+  // its replies to GS r tell. Needs status_interval, and a baud rate at which the bands arrive
+  // faster than they print.
+  void calibrate_timing();
 
   size_t write(uint8_t c);
 
   // Display buffer
-  int get_width_internal() override { return 8 * 58; };  // 58mm, 8 dots per mm
+  int get_width_internal() override { return PAPER_WIDTH; };
   int get_height_internal() override { return this->height_; };
 
+  // The lambda gets the printer itself as `it`, so it reaches the byte-wide primitives and printer-only
+  // drawing below rather than the generic Display versions.
+  void set_writer(thermal_printer_writer_t &&writer) { this->writer_local_ = writer; }
   void set_height(int height) { this->height_ = height; }
+  // Render the page in bands of this many rows instead of one full-height buffer (0 = full page).
+  void set_band_height(uint16_t band_height) { this->band_height_ = band_height; }
+  // Upper bound on the time a single loop() pass spends feeding the printer.
+  void set_max_loop_time(uint32_t max_loop_time) { this->max_loop_time_ = max_loop_time; }
+  void set_tx_buffer_size(size_t tx_buffer_size) { this->tx_buffer_size_ = tx_buffer_size; }
+  // Keep a second page buffer, so the next page can be rendered while the previous one is sent.
+  // Full-page mode only, and twice the memory.
+  void set_double_buffer(bool double_buffer) { this->double_buffer_ = double_buffer; }
+  // Landscape page for banners and labels: drawn rotated by 90 degrees, so it is `height` long along
+  // the paper and the paper width high. Each band is drawn into a strip in its own orientation and
+  // turned into printer rows 8x8 dots at a time, rather than rotating every pixel as it is drawn.
+  void set_banner(bool banner) { this->banner_ = banner; }
+  void set_max_chunk_height(uint8_t max_chunk_height) { this->maxChunkHeight = max_chunk_height; }
+  // Printer's DTR (busy) output; once set up, data is sent whenever it signals ready.
+  void set_dtr_pin(InternalGPIOPin *dtr_pin) { this->dtr_pin_ = dtr_pin; }
+  // Ask the printer for its status this often over the UART's RX line (0 = never). Sending stops
+  // while it reports paper out, cover open or an overheated head.
+  void set_status_interval(uint32_t status_interval) { this->status_interval_ = status_interval; }
+  // Switch printer and UART to this baud rate at startup (0 = keep the UART's configured rate).
+  void set_upgrade_baud_rate(uint32_t upgrade_baud_rate) { this->upgrade_baud_rate_ = upgrade_baud_rate; }
+  // Printer firmware version times 100 (e.g. 268 for 2.68), selects which commands are used.
+  void set_firmware(uint16_t firmware) { this->firmware = firmware; }
+  void set_qr_module_size(uint8_t qr_module_size) { this->qr_module_size_ = qr_module_size; }
+
+  // Transmit buffer usage, for sizing tx_buffer_size.
+  size_t get_tx_high_water_mark() const { return this->tx_buffer_.high_water_mark(); }
+  uint32_t get_tx_dropped() const { return this->tx_dropped_; }
+
+  void fill(Color color) override;
+  using display::DisplayBuffer::draw_pixel_at;
+  void draw_pixel_at(int x, int y, Color color) override;
+  // Byte-wide versions of the DisplayBuffer primitives. These aren't virtual in DisplayBuffer, so
+  // they are used when called on the printer itself: from the lambda, or as id(printer).filled_rectangle(...).
+  void horizontal_line(int x, int y, int width, Color color = display::COLOR_ON);
+  void vertical_line(int x, int y, int height, Color color = display::COLOR_ON);
+  void filled_rectangle(int x1, int y1, int width, int height, Color color = display::COLOR_ON);
+
+  // Text through a cache of pre-rasterized glyphs that are OR-ed into the buffer a byte at a time.
+  // Glyphs are rasterized through the font the first time they are used.
+  void print_cached(int x, int y, display::BaseFont *font, Color color, display::TextAlign align, const char *text);
+  void print_cached(int x, int y, display::BaseFont *font, Color color, const char *text) {
+    this->print_cached(x, y, font, color, display::TextAlign::TOP_LEFT, text);
+  }
+  void print_cached(int x, int y, display::BaseFont *font, const char *text) {
+    this->print_cached(x, y, font, display::COLOR_ON, display::TextAlign::TOP_LEFT, text);
+  }
 
   display::DisplayType get_display_type() override { return display::DisplayType::DISPLAY_TYPE_BINARY; }
 
+  // Print text with its characters font_size + 1 times as wide and high (GS !), up to 7.
   void print_text(std::string text, uint8_t font_size = 0);
+  std::vector<std::string> wrapText(const std::string &text);
   void new_line(uint8_t lines);
   void print_qrcode(std::string data);
+  void draw_qrcode(int x, int y, const std::string &data, int scale = 4, Color color = display::COLOR_ON);
+  // Draw a grayscale or color image into the page, dithered to black dots. Only black dots are
+  // drawn; white leaves the page as it was.
+  void draw_image_dithered(int x, int y, image::Image *image, DitherMode mode = DITHER_FLOYD_STEINBERG);
 
   void print_barcode(std::string barcode, BarcodeType type);
 
+  // Job queue. Jobs are started from loop() one at a time, once the printer has finished the
+  // previous one. The print methods above bypass the queue and go straight to the transmit buffer.
+  void set_job_queue_size(uint8_t job_queue_size) { this->job_queue_size_ = job_queue_size; }
+  bool enqueue_job(PrintJob &&job);
+  bool enqueue_text(const std::string &text, uint8_t font_size = 0, uint8_t priority = 0);
+  bool enqueue_page(uint8_t priority = 0);
+  bool enqueue_feed(uint8_t lines, uint8_t priority = 0);
+  bool enqueue_qrcode(const std::string &data, uint8_t priority = 0);
+  bool enqueue_barcode(const std::string &barcode, BarcodeType type, uint8_t priority = 0);
+  // Print an image centred on the paper, dithered and streamed row by row without using the page buffer.
+  bool enqueue_image(image::Image *image, DitherMode mode = DITHER_FLOYD_STEINBERG, uint8_t priority = 0);
+  // Print styled lines, each with the printer's own font where the code page selected with
+  // setCodePage() has all its characters, else as raster through the receipt font.
+  bool enqueue_receipt(std::vector<ReceiptLine> lines, uint8_t priority = 0);
+  void set_receipt_font(display::BaseFont *receipt_font) { this->receipt_font_ = receipt_font; }
+  // Code page set by setDefault(), and the one receipts are encoded in until setCodePage() changes it.
+  void set_code_page(uint8_t code_page) { this->code_page_ = code_page; }
+  // Drop all jobs that haven't been started yet. The job being printed runs to completion.
+  void cancel_jobs();
+  size_t get_queued_jobs() const { return this->jobs_.size(); }
+  // True once the printer has booted and taken the init sequence queued by setup(). Queued jobs wait for it.
+  bool is_ready() const { return this->init_state_ == INIT_READY; }
+  void add_on_job_complete_callback(std::function<void()> &&callback) {
+    this->job_complete_callback_.add(std::move(callback));
+  }
+  void add_on_queue_empty_callback(std::function<void()> &&callback) {
+    this->queue_empty_callback_.add(std::move(callback));
+  }
+
  protected:
   void draw_absolute_pixel_internal(int x, int y, Color color) override;
-  size_t get_buffer_length_() { return size_t(this->get_width_internal()) * size_t(this->get_height_internal()) / 8; }
-  void queue_data_(std::vector<uint8_t> data);
-  void queue_data_(const uint8_t *data, size_t size);
+  size_t get_buffer_length_() { return ROW_BYTES * size_t(this->get_buffer_rows_()); }
+  int get_buffer_rows_() {
+    if (this->band_height_ == 0 || this->band_height_ > this->height_)
+      return this->height_;
+    return this->band_height_;
+  }
+  void render_band_();
+  void render_page_();
+  void begin_page_();
+  bool render_buffer_busy_() { return this->page_queued_ || (!this->double_buffer_ && this->page_sending_); }
+  bool send_page_();
+  bool row_is_blank_(int page_row);
+  uint16_t row_dots_(int page_row);
+  void render_();
+  void run_writer_();
+  void draw_timing_test_();
+  void clear_dirty_();
+  void fill_rect_internal_(int x1, int y1, int x2, int y2, bool on);
+
+  // A glyph packed 1bpp, rows padded to whole bytes, positioned relative to the text origin.
+  struct CachedGlyph {
+    int16_t x_offset;
+    int16_t y_offset;
+    uint16_t width;
+    uint16_t height;
+    int16_t advance;
+    std::vector<uint8_t> bitmap;
+  };
+  const CachedGlyph &get_cached_glyph_(display::BaseFont *font, const char *text, size_t length);
+  void blit_glyph_(const CachedGlyph &glyph, int x, int y, bool on);
+
+  struct TimingCoefficients {
+    uint32_t row_time{2100};   // Fixed cost per raster row (us), mostly the paper step
+    uint16_t heat_scale{100};  // Percentage of the configured heat time + interval per dot group
+  };
+  TimingCoefficients timing_;
+  optional<TimingCoefficients> config_timing_{};
+  ESPPreferenceObject timing_pref_;
+  bool timing_test_{false};
+  // Sums for a least squares fit of each timed raster block's print time to its rows and dot groups
+  struct CalibrationSums {
+    float rows_rows{0}, rows_groups{0}, groups_groups{0}, rows_time{0}, groups_time{0};
+    uint8_t blocks{0};
+  };
+  uint32_t dot_groups_(uint16_t dots);
+  void add_calibration_sample_(uint32_t now);
+  void finish_calibration_();
+  bool calibrating_{false};  // The page being sent is the timing test, time its blocks
+  CalibrationSums calibration_{};
+  optional<thermal_printer_writer_t> writer_local_{};
+
+  std::map<std::pair<display::BaseFont *, uint32_t>, CachedGlyph> glyph_cache_;
+  std::vector<std::pair<int16_t, int16_t>> *glyph_capture_{nullptr};  // Set while a glyph is being rasterized
+  // Track the span of buffer rows that may hold set pixels
+  void mark_dirty_(int first, int last) {
+    this->dirty_min_ = std::min(this->dirty_min_, first);
+    this->dirty_max_ = std::max(this->dirty_max_, last);
+  }
+  unsigned long write_raster_header_(uint16_t rows);
+  unsigned long write_feed_();
+  bool queue_data_(const uint8_t *data, size_t size);
+
+  // Printer settings tracked by queue_setting_(), one bit each in settings_known_.
+  enum Setting : uint8_t {
+    SETTING_ONLINE,          // ESC =
+    SETTING_JUSTIFY,         // ESC a
+    SETTING_PRINT_MODE,      // ESC !
+    SETTING_INVERSE,         // GS B
+    SETTING_UNDERLINE,       // ESC -
+    SETTING_LINE_HEIGHT,     // ESC 3
+    SETTING_BARCODE_HEIGHT,  // GS h
+    SETTING_CHARSET,         // ESC R
+    SETTING_CODE_PAGE,       // ESC t
+    SETTING_COUNT,
+  };
+  bool queue_setting_(Setting setting, const uint8_t *cmd, size_t size);
+  static std::vector<std::string> wrap_text(const std::string &text, uint8_t column, uint8_t width);
+  bool queue_text_line_(const std::string &line);
+  int encode_qrcode_(const std::string &data, std::vector<uint8_t> &qr);
+  int qrcode_scale_(int size);
+  uint16_t qrcode_row_bytes_(int size, int scale);
+  bool queue_qrcode_native_(const std::string &data);
+  bool queue_qrcode_row_(const uint8_t *qr, int size, int row);
+  void queue_feed_rows_(int rows);
+  bool queue_image_rows_();
+  bool queue_job_lines_();
+  bool set_font_size_(uint8_t font_size);
+  void read_luminance_(image::Image *image, int y, int x1, int x2, uint8_t *luma);
+  bool queue_byte_(uint8_t data);
+  void queue_pause_(uint32_t us);
+  size_t bytes_per_pass_();
+  void send_(const uint8_t *data, size_t len);
+  void start_job_();
+  void finish_job_();
+  void publish_queue_metrics_();
+  void start_print_job_();
+  void continue_print_job_();
+  void update_byte_time_();
+  bool switch_baud_rate_();
+  static void dtr_isr_(ThermalPrinterDisplay *arg);
   void init_();
 
-  std::queue<std::vector<uint8_t>> queue_{};
+  // Point in the transmit stream where loop() has to do something other than send buffered bytes.
+  struct TxMark {
+    enum Type : uint8_t {
+      PAUSE,      // Give the printer time to act on what came before
+      PAGE,       // Stream the rendered page from buffer_ at this point
+      DTR_ON,     // Printer has been told to signal busy on DTR, pace by the pin from here
+      BAUD_RATE,  // Printer has been told to change baud rate, follow it
+      IMAGE,      // Stream raw_image_ from where it is stored at this point
+    };
+    uint32_t pos;  // tx_buffer_ write position the mark applies at
+    Type type;
+    uint32_t pause{0};  // For PAUSE, in us
+  };
+  void queue_mark_(TxMark::Type type);
+
+  TxRingBuffer tx_buffer_;
+  // Shadow of the printer's settings. Only the values flagged in settings_known_ are trustworthy.
+  uint8_t settings_[SETTING_COUNT]{};
+  uint16_t settings_known_{0};
+  std::queue<TxMark> marks_{};
+  size_t tx_buffer_size_{1024};
+  uint32_t tx_dropped_{0};
+  uint32_t max_loop_time_{20};
+  uint32_t transfer_done_{0};  // micros() by which everything written to the UART has been sent
+  uint32_t byte_time_{1146};   // Time (us) to send one byte at the current UART settings
+
+  enum BaudState : uint8_t { BAUD_IDLE, BAUD_SWITCH, BAUD_CHECK, BAUD_REVERT };
+  uint32_t upgrade_baud_rate_{0};
+  uint32_t previous_baud_rate_{0};
+  uint32_t baud_deadline_{0};
+  BaudState baud_state_{BAUD_IDLE};
+
+  // setup() only queues the init sequence; loop() holds it back until the printer has booted, then
+  // sends it like any other data.
+  enum InitState : uint8_t { INIT_BOOT, INIT_SENDING, INIT_READY };
+  InitState init_state_{INIT_BOOT};
+
+  // Metrics. A job runs from the stream leaving idle until everything has been sent and printed.
+  uint32_t bytes_sent_{0};
+  uint32_t jobs_completed_{0};
+  bool job_active_{false};
+  uint32_t job_start_{0};     // millis() the current job started at
+  uint32_t job_bytes_{0};
+  uint32_t job_estimate_{0};  // Time (us) the printer has been given for the current job
+  uint32_t paced_time_{0};    // Time (us) loop() held data back in the current job
+  // Counted from the end of the previous job, as commands are queued before their job starts
+  uint32_t job_commands_dropped_{0};  // Settings left out because the printer already had them
+  uint32_t job_pushes_{0};            // Separate additions to the transmit buffer
+  uint32_t job_writes_{0};            // UART writes they went out in
+  uint32_t paced_since_{0};
+  bool paced_{false};
+  uint32_t render_time_{0};  // Time (us) spent rendering the current page
+  uint32_t last_publish_{0};
+
+  InternalGPIOPin *dtr_pin_{nullptr};
+  ISRInternalGPIOPin dtr_isr_pin_;
+  volatile bool dtr_ready_{false};
+
+  // Status polling. Queries only go out between commands, never inside one.
+  void update_status_();
+  void send_status_query_(const uint8_t *data, size_t len);
+  void read_status_();
+  void apply_status_();
+  uint32_t status_interval_{0};
+  uint32_t status_sent_{0};         // millis() the last DLE EOT poll went out
+  uint8_t status_[4]{};             // Replies to DLE EOT 1 to 4
+  uint8_t status_received_{4};      // Replies to the current poll so far, 4 when none is outstanding
+  bool status_answered_{false};     // The printer has replied at least once
+  bool status_hold_{false};         // Sending suspended until the printer reports it can print
+  bool idle_query_pending_{false};  // GS r 1 sent; its reply means the printer has caught up
+  uint32_t idle_query_sent_{0};     // millis() it went out
+  uint32_t idle_query_bytes_{0};    // bytes_sent_ just after it; later data makes the reply stale
+  bool at_boundary_{true};          // Everything sent so far ends with a complete command
+  HighFrequencyLoopRequester high_freq_;
+
   int height_{0};
+  uint16_t band_height_{0};
+  int band_start_{0};  // Page row that maps to row 0 of buffer_
+  int band_rows_{0};   // Rows of the current band held in buffer_
+  int page_row_{0};    // Next page row to send
+  int block_end_{0};   // Page row the raster block being sent ends at
+  unsigned long block_time_{0};  // Estimated time to print the raster block being sent
+  int block_rows_{0};            // Its rows, dot groups and when its first row went out (us), for calibration
+  uint32_t block_groups_{0};
+  uint32_t block_sent_{0};
+  int pending_feed_{0};       // Blank rows skipped but not yet fed
+  int dirty_min_{INT32_MAX};  // Buffer rows outside [dirty_min_, dirty_max_] are known to be blank
+  int dirty_max_{-1};
+  uint32_t page_bytes_sent_{0};
+  // The page being sent comes from send_buffer_. That is buffer_ itself, unless double buffering
+  // gives the writer a second buffer to render the next page into meanwhile.
+  uint8_t *send_buffer_{nullptr};
+  int send_dirty_min_{INT32_MAX};
+  int send_dirty_max_{-1};
+  bool double_buffer_{false};
+  // Banner mode draws each band into strip_ in landscape orientation: a row per printer dot across
+  // the paper, strip_stride_ bytes of page rows each. transpose_strip_() turns it into buffer_ rows.
+  void transpose_strip_();
+  void fill_strip_(int x1, int y1, int x2, int y2, bool on);
+  bool banner_{false};
+  uint8_t *strip_{nullptr};
+  size_t strip_stride_{0};
+  int strip_dirty_min_{INT32_MAX};  // Strip rows outside [strip_dirty_min_, strip_dirty_max_] are blank
+  int strip_dirty_max_{-1};
+  bool page_queued_{false};       // A PAGE mark is waiting, its page is in buffer_
+  bool page_sending_{false};      // A page is going out of send_buffer_
+  bool page_prerendered_{false};  // buffer_ holds a page rendered ahead for the next queued page job
+  uint32_t next_render_time_{0};  // Time (us) spent rendering the page in buffer_
+
+  std::deque<PrintJob> jobs_{};
+  uint8_t job_queue_size_{16};
+  bool print_job_active_{false};
+  std::vector<std::string> job_lines_{};  // Wrapped lines of the TEXT job being printed
+  size_t job_line_{0};                    // Next of job_lines_ to queue
+  uint8_t job_font_size_{0};              // Of the TEXT job, set back to 0 once its lines are queued
+  std::vector<uint8_t> job_qr_{};  // Encoded QR code being printed as raster
+  int job_qr_size_{0};
+  int job_qr_row_{0};  // Next module row of job_qr_ to queue
+  image::Image *job_image_{nullptr};  // Image being streamed as raster
+  int job_image_row_{0};              // Next row of job_image_ to queue
+  // Binary images are already printer dots and go to the UART from where they are stored
+  bool send_image_();
+  void send_image_data_(const uint8_t *data, size_t len);
+  image::Image *raw_image_{nullptr};
+  int raw_image_row_{0};             // Next row of raw_image_ to send
+  int raw_block_end_{0};             // Row the raster block being sent ends at
+  unsigned long raw_block_time_{0};  // Estimated time to print that block
+  Ditherer job_ditherer_;
+  // Receipt jobs are planned into printer lines up front: encoded text ending in '\n', or UTF-8 to
+  // render as raster. Raster lines are rendered into job_raster_ one at a time.
+  struct ReceiptRow {
+    bool raster;
+    uint8_t style;
+    char align;
+    std::string data;
+  };
+  void plan_receipt_(const std::vector<ReceiptLine> &lines);
+  bool encode_receipt_text_(const std::string &text, std::string &encoded);
+  std::vector<std::string> wrap_raster_text_(const std::string &text, uint8_t style);
+  void start_receipt_row_(const ReceiptRow &row);
+  void render_receipt_row_(const ReceiptRow &row);
+  bool queue_raster_rows_();
+  display::BaseFont *receipt_font_{nullptr};
+  uint8_t code_page_{0};                   // Last set with setCodePage()
+  std::vector<ReceiptRow> job_receipt_{};  // Planned lines of the RECEIPT job being printed
+  size_t job_receipt_row_{0};              // Next of job_receipt_ to queue
+  std::vector<uint8_t> job_raster_{};      // Rendered raster line, ROW_BYTES per row
+  int job_raster_row_{0};                  // Next row of job_raster_ to queue
+  int job_raster_end_{0};                  // Rows of job_raster_ to print, the rest is fed
+  uint8_t qr_module_size_{4};
+  CallbackManager<void()> job_complete_callback_{};
+  CallbackManager<void()> queue_empty_callback_{};
 
  private:
-  uint8_t printMode,
-      prevByte,       // Last character issued to printer
-      column,         // Last horizontal column printed
-      maxColumn,      // Page width (output 'wraps' at this point)
-      charHeight,     // Height of characters, in 'dots'
-      lineSpacing,    // Inter-line spacing (not line height), in dots
-      barcodeHeight,  // Barcode height in dots, not including text
-      maxChunkHeight,
-      dtrPin;                // DTR handshaking pin (experimental)
-  uint16_t firmware;         // Firmware version
-  bool dtrEnabled;           // True if DTR pin set & printer initialized
-  unsigned long resumeTime,  // Wait until micros() exceeds this before sending byte
-      dotPrintTime,          // Time to print a single dot line, in microseconds
-      dotFeedTime;           // Time to feed a single dot line, in microseconds
+  uint8_t printMode{0},
+      prevByte{'\n'},           // Last character issued to printer
+      column{0},                // Last horizontal column printed
+      maxColumn{32},            // Page width (output 'wraps' at this point)
+      charHeight{24},           // Height of characters, in 'dots'
+      lineSpacing{6},           // Inter-line spacing (not line height), in dots
+      barcodeHeight{50},        // Barcode height in dots, not including text
+      maxChunkHeight{255},      // Rows per raster block
+      heatDots{11},             // Max heating dots, units of 8 dots minus 1 (see setHeatConfig())
+      heatTime{120},            // Heating time, units of 10us
+      heatInterval{40};         // Heating interval, units of 10us
+  uint16_t firmware{268};       // Firmware version
+  bool dtrEnabled{false};       // True if DTR pin set & printer initialized
+  unsigned long resumeTime{0},  // Wait until micros() exceeds this before sending byte
+      dotPrintTime{30000},      // Time to print a single dot line, in microseconds
+      dotFeedTime{2100};        // Time to feed a single dot line, in microseconds
   void setPrintMode(uint8_t mask), unsetPrintMode(uint8_t mask), writePrintMode(), adjustCharValues(uint8_t printMode);
+  unsigned long lineTime();
 };
 
 template<typename... Ts>
@@ -106,8 +548,136 @@ class ThermalPrinterPrintTextAction : public Action<Ts...>, public Parented<Ther
  public:
   TEMPLATABLE_VALUE(std::string, text)
   TEMPLATABLE_VALUE(uint8_t, font_size)
+  TEMPLATABLE_VALUE(uint8_t, priority)
+
+  void play(Ts... x) override {
+    this->parent_->enqueue_text(this->text_.value(x...), this->font_size_.value(x...), this->priority_.value(x...));
+  }
+};
+
+template<typename... Ts>
+class ThermalPrinterPrintPageAction : public Action<Ts...>, public Parented<ThermalPrinterDisplay> {
+ public:
+  TEMPLATABLE_VALUE(uint8_t, priority)
+
+  void play(Ts... x) override { this->parent_->enqueue_page(this->priority_.value(x...)); }
+};
+
+template<typename... Ts>
+class ThermalPrinterFeedAction : public Action<Ts...>, public Parented<ThermalPrinterDisplay> {
+ public:
+  TEMPLATABLE_VALUE(uint8_t, lines)
+  TEMPLATABLE_VALUE(uint8_t, priority)
+
+  void play(Ts... x) override { this->parent_->enqueue_feed(this->lines_.value(x...), this->priority_.value(x...)); }
+};
+
+template<typename... Ts>
+class ThermalPrinterPrintQRCodeAction : public Action<Ts...>, public Parented<ThermalPrinterDisplay> {
+ public:
+  TEMPLATABLE_VALUE(std::string, data)
+  TEMPLATABLE_VALUE(uint8_t, priority)
 
-  void play(Ts... x) override { this->parent_->print_text(this->text_.value(x...), this->font_size_.value(x...)); }
+  void play(Ts... x) override { this->parent_->enqueue_qrcode(this->data_.value(x...), this->priority_.value(x...)); }
+};
+
+template<typename... Ts>
+class ThermalPrinterPrintBarcodeAction : public Action<Ts...>, public Parented<ThermalPrinterDisplay> {
+ public:
+  TEMPLATABLE_VALUE(std::string, data)
+  TEMPLATABLE_VALUE(uint8_t, priority)
+  void set_type(BarcodeType type) { this->type_ = type; }
+
+  void play(Ts... x) override {
+    this->parent_->enqueue_barcode(this->data_.value(x...), this->type_, this->priority_.value(x...));
+  }
+
+ protected:
+  BarcodeType type_{CODE128};
+};
+
+template<typename... Ts>
+class ThermalPrinterPrintImageAction : public Action<Ts...>, public Parented<ThermalPrinterDisplay> {
+ public:
+  TEMPLATABLE_VALUE(uint8_t, priority)
+  void set_image(image::Image *image) { this->image_ = image; }
+  void set_dither(DitherMode dither) { this->dither_ = dither; }
+
+  void play(Ts... x) override {
+    this->parent_->enqueue_image(this->image_, this->dither_, this->priority_.value(x...));
+  }
+
+ protected:
+  image::Image *image_{nullptr};
+  DitherMode dither_{DITHER_FLOYD_STEINBERG};
+};
+
+template<typename... Ts>
+class ThermalPrinterPrintReceiptAction : public Action<Ts...>, public Parented<ThermalPrinterDisplay> {
+ public:
+  TEMPLATABLE_VALUE(uint8_t, priority)
+  void add_line(TemplatableValue<std::string, Ts...> text, uint8_t style, char align) {
+    this->lines_.push_back(Line{std::move(text), style, align});
+  }
+
+  void play(Ts... x) override {
+    std::vector<ReceiptLine> lines;
+    lines.reserve(this->lines_.size());
+    for (auto &line : this->lines_)
+      lines.push_back(ReceiptLine{line.text.value(x...), line.style, line.align});
+    this->parent_->enqueue_receipt(std::move(lines), this->priority_.value(x...));
+  }
+
+ protected:
+  struct Line {
+    TemplatableValue<std::string, Ts...> text;
+    uint8_t style;
+    char align;
+  };
+  std::vector<Line> lines_{};
+};
+
+template<typename... Ts>
+class ThermalPrinterCancelAction : public Action<Ts...>, public Parented<ThermalPrinterDisplay> {
+ public:
+  void play(Ts... x) override { this->parent_->cancel_jobs(); }
+};
+
+template<typename... Ts>
+class ThermalPrinterPrintTimingTestAction : public Action<Ts...>, public Parented<ThermalPrinterDisplay> {
+ public:
+  void play(Ts... x) override { this->parent_->print_timing_test(); }
+};
+
+template<typename... Ts>
+class ThermalPrinterCalibrateTimingAction : public Action<Ts...>, public Parented<ThermalPrinterDisplay> {
+ public:
+  void play(Ts... x) override { this->parent_->calibrate_timing(); }
+};
+
+template<typename... Ts>
+class ThermalPrinterSetTimingAction : public Action<Ts...>, public Parented<ThermalPrinterDisplay> {
+ public:
+  TEMPLATABLE_VALUE(uint32_t, row_time)
+  TEMPLATABLE_VALUE(uint16_t, heat_scale)
+
+  void play(Ts... x) override {
+    this->parent_->set_timing_coefficients(this->row_time_.value(x...), this->heat_scale_.value(x...));
+  }
+};
+
+class JobCompleteTrigger : public Trigger<> {
+ public:
+  explicit JobCompleteTrigger(ThermalPrinterDisplay *parent) {
+    parent->add_on_job_complete_callback([this]() { this->trigger(); });
+  }
+};
+
+class QueueEmptyTrigger : public Trigger<> {
+ public:
+  explicit QueueEmptyTrigger(ThermalPrinterDisplay *parent) {
+    parent->add_on_queue_empty_callback([this]() { this->trigger(); });
+  }
 };
 
 }  // namespace thermal_printer
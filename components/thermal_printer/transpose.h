@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cinttypes>
+
+namespace esphome {
+namespace thermal_printer {
+
+// Transpose an 8x8 bit matrix packed into 64 bits, row 0 in the top byte and column 0 in the MSB of
+// each row: bit (7 - j) of row i becomes bit (7 - i) of row j. Three rounds of delta swaps exchange
+// the off-diagonal 1x1, 2x2 and 4x4 blocks (Hacker's Delight, section 7-3).
+inline uint64_t transpose_8x8(uint64_t x) {
+  uint64_t t;
+  t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+  x = x ^ t ^ (t << 7);
+  t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+  x = x ^ t ^ (t << 14);
+  t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+  x = x ^ t ^ (t << 28);
+  return x;
+}
+
+}  // namespace thermal_printer
+}  // namespace esphome
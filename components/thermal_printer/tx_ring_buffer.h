@@ -0,0 +1,87 @@
+#pragma once
+
+#include "esphome/core/helpers.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+
+namespace esphome {
+namespace thermal_printer {
+
+// Fixed-capacity byte FIFO for the outgoing printer stream. Producers reserve contiguous space and
+// write into it directly, loop() hands contiguous spans straight to the UART. Besides the storage
+// offsets it keeps free-running read and write positions, which can be used to tag points in the
+// stream.
+class TxRingBuffer {
+ public:
+  bool init(size_t capacity) {
+    ExternalRAMAllocator<uint8_t> allocator(ExternalRAMAllocator<uint8_t>::ALLOW_FAILURE);
+    this->data_ = allocator.allocate(capacity);
+    if (this->data_ == nullptr) {
+      return false;
+    }
+    this->capacity_ = capacity;
+    return true;
+  }
+
+  size_t capacity() const { return this->capacity_; }
+  size_t size() const { return this->write_pos_ - this->read_pos_; }
+  size_t free() const { return this->capacity_ - this->size(); }
+  bool empty() const { return this->write_pos_ == this->read_pos_; }
+  uint32_t read_pos() const { return this->read_pos_; }
+  uint32_t write_pos() const { return this->write_pos_; }
+  size_t high_water_mark() const { return this->high_water_mark_; }
+
+  // Contiguous space for up to `len` bytes at the write position. `granted` receives how much of it
+  // is usable before the end of the storage; nothing becomes readable until commit().
+  uint8_t *reserve(size_t len, size_t *granted) {
+    *granted = std::min(std::min(len, this->free()), this->capacity_ - this->write_offset_);
+    return this->data_ + this->write_offset_;
+  }
+
+  void commit(size_t len) {
+    this->write_pos_ += len;
+    this->write_offset_ = (this->write_offset_ + len) % this->capacity_;
+    this->high_water_mark_ = std::max(this->high_water_mark_, this->size());
+  }
+
+  // Append all of `data`, or nothing if it doesn't fit.
+  bool push(const uint8_t *data, size_t len) {
+    if (len > this->free()) {
+      return false;
+    }
+    while (len > 0) {
+      size_t granted;
+      uint8_t *dst = this->reserve(len, &granted);
+      memcpy(dst, data, granted);
+      this->commit(granted);
+      data += granted;
+      len -= granted;
+    }
+    return true;
+  }
+
+  // Contiguous readable span at the read position.
+  const uint8_t *peek(size_t *len) const {
+    *len = std::min(this->size(), this->capacity_ - this->read_offset_);
+    return this->data_ + this->read_offset_;
+  }
+
+  void consume(size_t len) {
+    this->read_pos_ += len;
+    this->read_offset_ = (this->read_offset_ + len) % this->capacity_;
+  }
+
+ protected:
+  uint8_t *data_{nullptr};
+  size_t capacity_{0};
+  size_t read_offset_{0};
+  size_t write_offset_{0};
+  uint32_t read_pos_{0};
+  uint32_t write_pos_{0};
+  size_t high_water_mark_{0};
+};
+
+}  // namespace thermal_printer
+}  // namespace esphome
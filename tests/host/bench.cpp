@@ -0,0 +1,273 @@
+// Fixed print scenarios run against the fake printer. For each: bytes on the wire, simulated print
+// time, input buffer overruns and the CPU time the component spent on it. What was printed is
+// written as <scenario>.pbm to the directory given on the command line.
+//
+// Then microbenchmarks of the drawing code, timed with the page buffer in place: each primitive drawn
+// byte-wide against the pixel-by-pixel DisplayBuffer version, text through the glyph cache against
+// the font drawing it pixel by pixel, image dithering, and a banner rotated per pixel against one
+// drawn into a strip and transposed.
+
+#include "harness.h"
+#include "page_display.h"
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::thermal_printer;
+
+static BlockFont font;
+
+// A photo-like grayscale image the width of the paper: a gradient with a dark disc.
+static const int PHOTO_WIDTH = FakePrinter::PAPER_WIDTH;
+static const int PHOTO_HEIGHT = 400;
+static std::vector<uint8_t> make_photo() {
+  std::vector<uint8_t> data(PHOTO_WIDTH * PHOTO_HEIGHT);
+  for (int y = 0; y < PHOTO_HEIGHT; y++) {
+    for (int x = 0; x < PHOTO_WIDTH; x++) {
+      int dx = x - PHOTO_WIDTH / 2, dy = y - PHOTO_HEIGHT / 2;
+      int value = x * 255 / PHOTO_WIDTH;
+      if (dx * dx + dy * dy < 120 * 120)
+        value = value / 3 + (y * 64 / PHOTO_HEIGHT);
+      data[y * PHOTO_WIDTH + x] = value;
+    }
+  }
+  return data;
+}
+static const std::vector<uint8_t> PHOTO_DATA = make_photo();
+static image::Image photo(PHOTO_DATA.data(), PHOTO_WIDTH, PHOTO_HEIGHT, image::IMAGE_TYPE_GRAYSCALE);
+
+struct Scenario {
+  const char *name;
+  uint32_t baud_rate;
+  std::function<void(Harness &)> configure;
+  std::function<void(Harness &)> run;
+};
+
+static void draw_page(ThermalPrinterDisplay &it) {
+  const int width = it.get_width();
+  it.rectangle(0, 0, width, 1000);
+  for (int y = 20; y < 1000; y += 120) {
+    it.filled_rectangle(20, y, width - 40, 40);
+    it.filled_rectangle(40, y + 10, width - 80, 20, display::COLOR_OFF);
+    it.print(20, y + 50, &font, "Full page raster benchmark");
+    it.line(20, y + 75, width - 20, y + 110);
+  }
+}
+
+static const std::vector<Scenario> SCENARIOS = {
+    {"text_receipt", 9600, [](Harness &h) { h.display.set_tx_buffer_size(4096); },
+     [](Harness &h) {
+       std::string receipt;
+       for (int i = 0; i < 40; i++)
+         receipt += "Item " + std::to_string(i) + "                 " + std::to_string(i * 3 / 2) + ".50\n";
+       h.display.print_text(receipt);
+       h.display.feed(3);
+     }},
+    {"full_page_raster", 115200,
+     [](Harness &h) {
+       h.display.set_height(1000);
+       h.display.set_writer(draw_page);
+     },
+     [](Harness &h) { h.update(); }},
+    {"mixed_content", 19200,
+     [](Harness &h) {
+       h.display.set_height(200);
+       h.display.set_writer([](ThermalPrinterDisplay &it) {
+         it.filled_rectangle(0, 0, it.get_width(), 24);
+         it.print(10, 40, &font, "Order 1234");
+         it.draw_qrcode(250, 40, "https://example.com/orders/1234", 3);
+       });
+     },
+     [](Harness &h) {
+       h.display.print_text("Order 1234\nTable 7\n");
+       h.update();
+       h.display.print_qrcode("https://example.com/orders/1234");
+       h.display.print_barcode("12345678", CODE128);
+       h.display.feed(3);
+     }},
+    {"streamed_photo", 115200, [](Harness &h) {},
+     [](Harness &h) {
+       h.display.enqueue_image(&photo, DITHER_FLOYD_STEINBERG);
+       h.display.enqueue_feed(3);
+     }},
+};
+
+// Wall clock time (us) per call of f, over enough calls to take about 50 ms.
+static double time_per_call(const std::function<void()> &f) {
+  using clock = std::chrono::steady_clock;
+  int calls = 0;
+  auto start = clock::now();
+  double elapsed;
+  do {
+    f();
+    calls++;
+    elapsed = std::chrono::duration<double, std::micro>(clock::now() - start).count();
+  } while (elapsed < 50000);
+  return elapsed / calls;
+}
+
+// Draw through ThermalPrinterDisplay for the byte-wide primitives, display::Display for the
+// pixel-by-pixel DisplayBuffer ones.
+template<typename D> static void draw_fill(D &it) { it.D::fill(display::COLOR_ON); }
+template<typename D> static void draw_rectangle(D &it) { it.filled_rectangle(37, 100, 300, 200); }
+template<typename D> static void draw_horizontal_lines(D &it) {
+  for (int y = 0; y < 1000; y += 10)
+    it.horizontal_line(3, y, it.get_width() - 6);
+}
+template<typename D> static void draw_vertical_lines(D &it) {
+  for (int x = 0; x < it.get_width(); x += 4)
+    it.vertical_line(x, 3, 994);
+}
+
+static void bench_primitives() {
+  struct Primitive {
+    const char *name;
+    void (*fast)(ThermalPrinterDisplay &);
+    void (*per_pixel)(display::Display &);
+  };
+  static const Primitive PRIMITIVES[] = {
+      {"fill", draw_fill<ThermalPrinterDisplay>, draw_fill<display::Display>},
+      {"filled_rectangle 300x200", draw_rectangle<ThermalPrinterDisplay>, draw_rectangle<display::Display>},
+      {"100 horizontal lines", draw_horizontal_lines<ThermalPrinterDisplay>, draw_horizontal_lines<display::Display>},
+      {"vertical lines 4 apart", draw_vertical_lines<ThermalPrinterDisplay>, draw_vertical_lines<display::Display>},
+  };
+  PageDisplay page(1000);
+  printf("\n%-26s %14s %14s %8s\n", "primitive (1000 rows)", "per-pixel us", "byte-wide us", "speedup");
+  for (const Primitive &p : PRIMITIVES) {
+    double per_pixel = time_per_call([&] { p.per_pixel(page); });
+    double fast = time_per_call([&] { p.fast(page); });
+    printf("%-26s %14.1f %14.1f %7.1fx\n", p.name, per_pixel, fast, per_pixel / fast);
+  }
+}
+
+// A typical 40-line receipt drawn into the page, through the glyph cache or pixel by pixel.
+static void draw_receipt(ThermalPrinterDisplay &it, bool cached) {
+  auto text = [&](int x, int y, display::TextAlign align, const std::string &s) {
+    if (cached) {
+      it.print_cached(x, y, &font, display::COLOR_ON, align, s.c_str());
+    } else {
+      it.print(x, y, &font, display::COLOR_ON, align, s.c_str());
+    }
+  };
+  const int width = it.get_width();
+  text(width / 2, 0, display::TextAlign::TOP_CENTER, "THE CORNER CAFE");
+  text(width / 2, 20, display::TextAlign::TOP_CENTER, "Order 1234  Table 7");
+  for (int i = 2; i < 38; i++) {
+    text(0, i * 20, display::TextAlign::TOP_LEFT, "1x Item " + std::to_string(i));
+    text(width, i * 20, display::TextAlign::TOP_RIGHT, std::to_string(i * 3 / 2) + ".50");
+  }
+  text(0, 760, display::TextAlign::TOP_LEFT, "TOTAL");
+  text(width, 760, display::TextAlign::TOP_RIGHT, "1071.00");
+  text(width / 2, 780, display::TextAlign::TOP_CENTER, "Thank you!");
+}
+
+static void bench_receipt() {
+  PageDisplay page(800);
+  double per_pixel = time_per_call([&] {
+    page.fill(display::COLOR_OFF);
+    draw_receipt(page, false);
+  });
+  double cached = time_per_call([&] {
+    page.fill(display::COLOR_OFF);
+    draw_receipt(page, true);
+  });
+  printf("\n%-26s %14s %14s %8s\n", "render", "per-pixel us", "cached us", "speedup");
+  printf("%-26s %14.1f %14.1f %7.1fx\n", "40-line receipt", per_pixel, cached, per_pixel / cached);
+}
+
+// Rows per second dithered into the page, against thresholding the image pixel by pixel through
+// Image::draw() as DisplayBuffer does.
+static void bench_dither() {
+  struct Mode {
+    const char *name;
+    DitherMode mode;
+  };
+  static const Mode MODES[] = {
+      {"threshold", DITHER_THRESHOLD},
+      {"floyd_steinberg", DITHER_FLOYD_STEINBERG},
+      {"bayer", DITHER_BAYER},
+  };
+  PageDisplay page(PHOTO_HEIGHT);
+  printf("\n%-26s %14s\n", ("image (" + std::to_string(PHOTO_WIDTH) + " wide)").c_str(), "rows/s");
+  double us = time_per_call([&] { page.image(0, 0, &photo); });
+  printf("%-26s %14.0f\n", "per-pixel Image::draw", PHOTO_HEIGHT * 1e6 / us);
+  for (const Mode &m : MODES) {
+    us = time_per_call([&] { page.draw_image_dithered(0, 0, &photo, m.mode); });
+    printf("%-26s %14.0f\n", m.name, PHOTO_HEIGHT * 1e6 / us);
+  }
+}
+
+// A landscape banner, `BANNER_LENGTH` dots along the paper.
+static const int BANNER_LENGTH = 1200;
+static void draw_banner(ThermalPrinterDisplay &it) {
+  const int height = ThermalPrinterDisplay::PAPER_WIDTH;
+  it.rectangle(0, 0, BANNER_LENGTH, height);
+  it.filled_rectangle(10, 10, BANNER_LENGTH - 20, 60);
+  for (int x = 20; x < BANNER_LENGTH - 200; x += 220)
+    it.print(x, 150, &font, "GRAND OPENING");
+  for (int x = 0; x < BANNER_LENGTH; x += 40)
+    it.filled_rectangle(x, height - 80, 20, 60);
+  it.line(0, height, BANNER_LENGTH, 0);
+}
+
+// Page render time (us) of the banner, rotated per pixel or drawn into the strip and transposed,
+// and what was printed.
+static double render_banner(bool strip, std::vector<uint8_t> *paper) {
+  Harness h(115200);
+  h.display.set_height(BANNER_LENGTH);
+  h.display.set_writer(draw_banner);
+  if (strip) {
+    h.display.set_banner(true);
+  } else {
+    h.display.set_rotation(display::DISPLAY_ROTATION_90_DEGREES);
+  }
+  h.setup();
+  const int pages = 5;
+  double total = 0;
+  for (int i = 0; i < pages; i++) {
+    h.printer.clear_paper();
+    auto start = std::chrono::steady_clock::now();
+    h.update();
+    total += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    CHECK(h.run_until_idle());
+  }
+  CHECK_EQ(h.printer.get_paper_rows(), BANNER_LENGTH);
+  paper->assign(h.printer.get_row(0), h.printer.get_row(0) + BANNER_LENGTH * ThermalPrinterDisplay::ROW_BYTES);
+  return total / pages;
+}
+
+static void bench_banner() {
+  std::vector<uint8_t> rotated_paper, strip_paper;
+  double rotated = render_banner(false, &rotated_paper);
+  double strip = render_banner(true, &strip_paper);
+  CHECK(strip_paper == rotated_paper);
+  printf("\n%-26s %14s %14s %8s\n", "banner render", "per-pixel us", "transpose us", "speedup");
+  printf("%-26s %14.1f %14.1f %7.1fx\n", ("1200 x " + std::to_string(ThermalPrinterDisplay::PAPER_WIDTH)).c_str(),
+         rotated, strip, rotated / strip);
+}
+
+int main(int argc, char **argv) {
+  std::string out_dir = argc > 1 ? argv[1] : ".";
+  printf("%-18s %8s %10s %10s %9s %10s\n", "scenario", "baud", "bytes", "print ms", "overruns", "cpu ms");
+  for (const Scenario &scenario : SCENARIOS) {
+    Harness h(scenario.baud_rate);
+    scenario.configure(h);
+    h.setup();
+    scenario.run(h);
+    CHECK(h.run_until_idle());
+    const PrinterSimulator::Stats &stats = h.printer.stats();
+    printf("%-18s %8u %10u %10u %9u %10.2f\n", scenario.name, (unsigned) scenario.baud_rate, (unsigned) stats.bytes,
+           (unsigned) (stats.print_time / 1000), (unsigned) stats.overrun_bytes, h.get_cpu_time() / 1000.0);
+    h.printer.write_pbm(out_dir + "/" + scenario.name + ".pbm");
+  }
+
+  bench_primitives();
+  bench_receipt();
+  bench_dither();
+  bench_banner();
+  return 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "esphome/components/display/display.h"
+
+#include <cstring>
+
+namespace esphome {
+namespace thermal_printer {
+
+// A font of 11x20 cells with a pattern per character, drawn pixel by pixel like the font component.
+class BlockFont : public display::BaseFont {
+ public:
+  static const int ADVANCE = 11;
+  static const int HEIGHT = 20;
+  static const int BASELINE = 16;
+
+  void print(int x, int y, display::Display *display, Color color, const char *text, Color background) override {
+    for (; *text != '\0'; text++, x += ADVANCE) {
+      unsigned c = (uint8_t) *text;
+      for (int row = 4; row < 18; row++) {
+        for (int col = 1; col < 10; col++) {
+          if ((c * 7 + row * 3 + col * 5) % 4 == 0)
+            display->draw_pixel_at(x + col, y + row, color);
+        }
+      }
+    }
+  }
+  void measure(const char *str, int *width, int *x_offset, int *baseline, int *height) override {
+    *width = ADVANCE * strlen(str);
+    *x_offset = 0;
+    *baseline = BASELINE;
+    *height = HEIGHT;
+  }
+};
+
+}  // namespace thermal_printer
+}  // namespace esphome
@@ -0,0 +1,333 @@
+#include "fake_printer.h"
+
+#include "esphome/core/hal.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace esphome {
+namespace thermal_printer {
+
+static const uint8_t ESC = 27;
+static const uint8_t GS = 29;
+static const uint8_t DC2 = 18;
+static const uint8_t DLE = 16;
+
+FakePrinter::FakePrinter(uart::UARTComponent *uart) : uart_(uart), baud_rate_(uart->get_baud_rate()) {
+  // The component's default timing: a paper step plus heating for each group of 96 dots
+  this->mechanism_.set_row_time([](uint16_t dots) { return 2100U + (dots + 95) / 96 * 1600U; });
+  uart->set_tx_callback([this](const uint8_t *data, size_t len) { this->receive_(data, len); });
+}
+
+void FakePrinter::update() {
+  uint32_t now = micros();
+  while (!this->replies_.empty() && (int32_t) (this->replies_.front().first - now) <= 0) {
+    this->uart_->inject_rx(this->replies_.front().second);
+    this->replies_.pop_front();
+  }
+  this->mechanism_.retire(now);
+  if (this->dtr_pin_ != nullptr && this->dtr_enabled_)
+    this->dtr_pin_->set_level(this->mechanism_.level() > this->dtr_threshold_);
+}
+
+bool FakePrinter::is_idle() const { return (int32_t) (this->mechanism_.busy_until() - micros()) <= 0; }
+
+void FakePrinter::receive_(const uint8_t *data, size_t len) {
+  if (this->uart_->get_baud_rate() != this->baud_rate_) {
+    this->garbled_bytes_ += len;  // Framing errors: nothing the printer can make sense of
+    return;
+  }
+  this->mechanism_.set_byte_time((10 * 1000000UL + this->baud_rate_ / 2) / this->baud_rate_);
+  this->mechanism_.receive(data, len, micros());
+  for (size_t i = 0; i < len; i++)
+    this->decode_(data[i]);
+}
+
+void FakePrinter::decode_(uint8_t c) {
+  switch (this->state_) {
+    case IDLE:
+      if (c == ESC || c == GS || c == DC2 || c == DLE) {
+        this->cmd_[0] = c;
+        this->cmd_len_ = 1;
+        this->state_ = SELECT;
+        return;
+      }
+      this->last_print_time_ = micros();
+      if (c == '\n') {
+        this->print_line_();
+      } else if (c >= ' ' && c != 0xFF) {
+        this->line_ += (char) c;
+        if ((this->line_.size() + 1) * CHAR_WIDTH * this->char_width_mul_ > (size_t) PAPER_WIDTH)
+          this->print_line_();  // The printer wraps long lines itself
+      }
+      return;
+    case SELECT: {
+      this->cmd_[this->cmd_len_++] = c;
+      uint8_t params = Mechanism::param_count_(this->cmd_[0], c);
+      if (params == 0xFF) {
+        fprintf(stderr, "FakePrinter: unknown command %02X %02X\n", this->cmd_[0], c);
+        params = 1;
+      }
+      if (this->cmd_[0] == ESC && c == 'D') {
+        this->state_ = NUL_TERMINATED;
+      } else if (params == 0) {
+        this->command_();
+      } else {
+        this->remaining_ = params;
+        this->state_ = PARAMS;
+      }
+      return;
+    }
+    case PARAMS:
+      if (this->cmd_len_ < sizeof(this->cmd_))
+        this->cmd_[this->cmd_len_++] = c;
+      if (--this->remaining_ == 0)
+        this->command_();
+      return;
+    case NUL_TERMINATED:
+      if (c == 0)
+        this->state_ = IDLE;
+      return;
+    case DATA:
+      this->last_print_time_ = micros();
+      if (--this->remaining_ == 0)
+        this->state_ = IDLE;
+      return;
+    case RASTER: {
+      this->last_print_time_ = micros();
+      int y = this->get_paper_rows() - 1;
+      for (int bit = 0; bit < 8; bit++) {
+        if (c & (0x80 >> bit))
+          this->set_dot_(this->raster_byte_ * 8 + bit, y);
+      }
+      if (++this->raster_byte_ < this->raster_width_)
+        return;
+      this->raster_byte_ = 0;
+      if (--this->raster_rows_ > 0) {
+        this->feed_(1);
+      } else {
+        this->state_ = IDLE;
+      }
+      return;
+    }
+  }
+}
+
+// All fixed bytes of the command are in cmd_.
+void FakePrinter::command_() {
+  const uint8_t *p = this->cmd_ + 2;
+  this->state_ = IDLE;
+  bool query = this->cmd_[0] == DLE || (this->cmd_[0] == GS && this->cmd_[1] == 'r');
+  if (!query)
+    this->last_print_time_ = micros();
+
+  if (this->cmd_[0] == DLE && this->cmd_[1] == 4) {
+    uint8_t reply = 0x12;
+    switch (p[0]) {
+      case 1:
+        if (this->paper_out_ || this->cover_open_)
+          reply |= 0x08;  // Offline
+        break;
+      case 2:
+        if (this->cover_open_)
+          reply |= 0x04;
+        if (this->paper_out_)
+          reply |= 0x20;
+        break;
+      case 3:
+        if (this->overheated_)
+          reply |= 0x40;
+        break;
+      case 4:
+        if (this->paper_out_)
+          reply |= 0x60;
+        break;
+    }
+    this->answer_(reply, false);
+  } else if (this->cmd_[0] == ESC) {
+    switch (this->cmd_[1]) {
+      case '@':
+        this->inits_++;
+        this->line_.clear();
+        this->char_width_mul_ = 1;
+        this->char_height_mul_ = 1;
+        this->line_height_ = 30;
+        this->justify_ = 0;
+        break;
+      case '!':
+        this->char_width_mul_ = (p[0] & 0x20) ? 2 : 1;
+        this->char_height_mul_ = (p[0] & 0x10) ? 2 : 1;
+        break;
+      case '3':
+        this->line_height_ = p[0];
+        break;
+      case 'a':
+        this->justify_ = p[0] % '0';
+        break;
+      case 'd':
+        this->feed_(p[0] * this->line_height_);
+        break;
+      case 'J':
+        this->feed_(p[0]);
+        break;
+      case '#':
+        if (p[0] == '#' && p[1] == 'S' && p[2] == 'B' && p[3] == 'D' && p[4] == 'R' && this->accept_baud_rate_)
+          this->baud_rate_ = p[5] | p[6] << 8 | p[7] << 16 | (uint32_t) p[8] << 24;
+        break;
+      case '*':
+        this->expect_data_((p[1] | p[2] << 8) * (p[0] >= 32 ? 3 : 1));
+        break;
+    }
+  } else if (this->cmd_[0] == GS) {
+    switch (this->cmd_[1]) {
+      case '!':
+        this->char_width_mul_ = ((p[0] >> 4) & 0x07) + 1;
+        this->char_height_mul_ = (p[0] & 0x07) + 1;
+        break;
+      case 'a':
+        this->dtr_enabled_ = p[0] & (1 << 5);
+        break;
+      case 'r':
+        this->answer_(this->paper_out_ ? 0x0C : 0x00, true);
+        break;
+      case 'v':
+        this->raster_width_ = p[2] | p[3] << 8;
+        this->raster_rows_ = p[4] | p[5] << 8;
+        if (this->raster_width_ != 0 && this->raster_rows_ != 0) {
+          this->raster_byte_ = 0;
+          this->feed_(1);
+          this->state_ = RASTER;
+        }
+        break;
+      case 'k':
+        this->barcodes_++;
+        if (p[0] <= 6) {
+          this->state_ = NUL_TERMINATED;
+        } else {
+          this->cmd_[1] = 'K';  // Length byte follows, then the data
+          this->remaining_ = 1;
+          this->state_ = PARAMS;
+        }
+        break;
+      case 'K':
+        this->expect_data_(p[1]);
+        break;
+      case '(': {
+        uint32_t len = p[1] | p[2] << 8;
+        if (p[0] == 'k' && len >= 2) {
+          this->block_len_ = len;
+          this->cmd_[1] = 'Q';  // cn fn follow, then the rest of the block
+          this->cmd_len_ = 2;
+          this->remaining_ = 2;
+          this->state_ = PARAMS;
+        } else {
+          this->expect_data_(len);
+        }
+        break;
+      }
+      case 'Q':
+        if (p[0] == 49 && p[1] == 81)
+          this->qr_codes_++;
+        this->expect_data_(this->block_len_ - 2);
+        break;
+      case '*':
+        this->expect_data_(p[0] * p[1] * 8);
+        break;
+    }
+  } else if (this->cmd_[0] == DC2 && this->cmd_[1] == '*') {
+    this->expect_data_(p[0] * p[1]);
+  }
+}
+
+void FakePrinter::expect_data_(uint32_t len) {
+  if (len == 0)
+    return;
+  this->remaining_ = len;
+  this->state_ = DATA;
+}
+
+void FakePrinter::answer_(uint8_t reply, bool in_order) {
+  this->status_queries_++;
+  if (!this->answer_status_)
+    return;
+  uint32_t due = micros();
+  if (in_order && (int32_t) (this->mechanism_.busy_until() - due) > 0)
+    due = this->mechanism_.busy_until();
+  this->replies_.emplace_back(due, reply);
+}
+
+// Text goes down as a box per character, the line as high as its tallest characters plus the line spacing.
+void FakePrinter::print_line_() {
+  int char_width = CHAR_WIDTH * this->char_width_mul_;
+  int char_height = CHAR_HEIGHT * this->char_height_mul_;
+  int spacing = this->line_height_ > CHAR_HEIGHT ? this->line_height_ - CHAR_HEIGHT : 0;
+  if (this->line_.empty()) {
+    this->feed_(this->line_height_);
+    return;
+  }
+  int top = this->get_paper_rows();
+  this->feed_(char_height + spacing);
+  int width = this->line_.size() * char_width;
+  int left = this->justify_ == 1 ? (PAPER_WIDTH - width) / 2 : this->justify_ == 2 ? PAPER_WIDTH - width : 0;
+  for (size_t i = 0; i < this->line_.size(); i++) {
+    if (this->line_[i] == ' ')
+      continue;
+    int x1 = left + i * char_width + 1, x2 = left + (i + 1) * char_width - 2;
+    int y1 = top + 2, y2 = top + char_height - 3;
+    for (int x = x1; x <= x2; x++) {
+      this->set_dot_(x, y1);
+      this->set_dot_(x, y2);
+    }
+    for (int y = y1; y <= y2; y++) {
+      this->set_dot_(x1, y);
+      this->set_dot_(x2, y);
+    }
+  }
+  this->text_lines_.push_back(this->line_);
+  this->line_.clear();
+}
+
+void FakePrinter::feed_(int rows) { this->paper_.resize(this->paper_.size() + rows * ROW_BYTES, 0); }
+
+void FakePrinter::set_dot_(int x, int y) {
+  if (x >= 0 && x < PAPER_WIDTH && y >= 0 && y < this->get_paper_rows())
+    this->paper_[y * ROW_BYTES + x / 8] |= 0x80 >> (x % 8);
+}
+
+bool FakePrinter::get_dot(int x, int y) const {
+  if (x < 0 || x >= PAPER_WIDTH || y < 0 || y >= this->get_paper_rows())
+    return false;
+  return this->paper_[y * ROW_BYTES + x / 8] & (0x80 >> (x % 8));
+}
+
+int FakePrinter::count_dots(int x1, int y1, int x2, int y2) const {
+  int dots = 0;
+  for (int y = y1; y < y2; y++) {
+    for (int x = x1; x < x2; x++)
+      dots += this->get_dot(x, y);
+  }
+  return dots;
+}
+
+bool FakePrinter::write_pbm(const std::string &path) const {
+  FILE *f = fopen(path.c_str(), "wb");
+  if (f == nullptr)
+    return false;
+  fprintf(f, "P4\n%d %d\n", PAPER_WIDTH, this->get_paper_rows());
+  bool ok = fwrite(this->paper_.data(), 1, this->paper_.size(), f) == this->paper_.size();
+  return fclose(f) == 0 && ok;
+}
+
+void FakePrinter::clear_paper() {
+  this->paper_.clear();
+  this->text_lines_.clear();
+  this->mechanism_.reset_stats();
+  this->qr_codes_ = 0;
+  this->barcodes_ = 0;
+  this->inits_ = 0;
+  this->garbled_bytes_ = 0;
+  this->status_queries_ = 0;
+}
+
+}  // namespace thermal_printer
+}  // namespace esphome
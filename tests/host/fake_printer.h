@@ -0,0 +1,142 @@
+#pragma once
+
+#include "esphome/components/uart/uart.h"
+
+#include "mock_pin.h"
+#include "printer_simulator.h"
+#include "thermal_printer.h"
+
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace esphome {
+namespace thermal_printer {
+
+// The printer at the other end of the stub UART. It hands the stream to PrinterSimulator for input
+// buffer and mechanism timing, and decodes it a second time onto a paper bitmap that tests can
+// inspect and write out as a PBM image. Text is drawn as one box per character, since the printer's
+// font isn't available.
+//
+// Like a real printer it answers real-time status requests (DLE EOT n) right away and GS r 1
+// once it has printed everything before it, only hears bytes sent at its own baud rate, and can
+// signal busy on a DTR pin.
+class FakePrinter {
+ public:
+  static constexpr int PAPER_WIDTH = ThermalPrinterDisplay::PAPER_WIDTH;
+  static constexpr size_t ROW_BYTES = ThermalPrinterDisplay::ROW_BYTES;
+  static const uint8_t CHAR_WIDTH = 12;
+  static const uint8_t CHAR_HEIGHT = 24;
+
+  explicit FakePrinter(uart::UARTComponent *uart);
+
+  // Call after each loop() pass: delivers GS r replies that have come due and moves the DTR pin.
+  void update();
+
+  // Status reported to DLE EOT and GS r queries
+  void set_paper_out(bool paper_out) { this->paper_out_ = paper_out; }
+  void set_cover_open(bool cover_open) { this->cover_open_ = cover_open; }
+  void set_overheated(bool overheated) { this->overheated_ = overheated; }
+  // Answer status queries at all (false: the printer's TX isn't wired up).
+  void set_answer_status(bool answer_status) { this->answer_status_ = answer_status; }
+  // Whether ESC # # S B D R switches the printer's baud rate, or is ignored as on older firmware.
+  void set_accept_baud_rate(bool accept_baud_rate) { this->accept_baud_rate_ = accept_baud_rate; }
+  // Baud rate the printer listens at; bytes sent at any other rate are lost.
+  void set_baud_rate(uint32_t baud_rate) { this->baud_rate_ = baud_rate; }
+  uint32_t get_baud_rate() const { return this->baud_rate_; }
+  void set_input_buffer_size(uint32_t size) { this->mechanism_.set_input_buffer_size(size); }
+  // Time to print one raster row with the given number of black dots
+  void set_row_time(std::function<uint32_t(uint16_t)> &&row_time) {
+    this->mechanism_.set_row_time(std::move(row_time));
+  }
+  // Once GS a enables it, hold the pin high while more than `threshold` bytes wait in the input buffer.
+  void set_dtr_pin(MockPin *pin, uint32_t threshold) {
+    this->dtr_pin_ = pin;
+    this->dtr_threshold_ = threshold;
+  }
+
+  // Everything received so far: bytes, paper used, simulated print time and overruns.
+  const PrinterSimulator::Stats &stats() const { return this->mechanism_.stats(); }
+  // True once the mechanism has worked through everything received.
+  bool is_idle() const;
+  // Time (us) of the last byte that wasn't a status query.
+  uint32_t get_last_print_time() const { return this->last_print_time_; }
+  uint32_t get_garbled_bytes() const { return this->garbled_bytes_; }
+  uint32_t get_status_queries() const { return this->status_queries_; }
+  uint32_t get_qr_codes() const { return this->qr_codes_; }
+  uint32_t get_barcodes() const { return this->barcodes_; }
+  uint32_t get_inits() const { return this->inits_; }
+
+  // Printed paper, PAPER_WIDTH dots wide
+  int get_paper_rows() const { return this->paper_.size() / ROW_BYTES; }
+  bool get_dot(int x, int y) const;
+  int count_dots(int x1, int y1, int x2, int y2) const;  // In [x1, x2) x [y1, y2)
+  const uint8_t *get_row(int y) const { return &this->paper_[y * ROW_BYTES]; }
+  // Text lines as received, in the printer's code page
+  const std::vector<std::string> &get_text_lines() const { return this->text_lines_; }
+  bool write_pbm(const std::string &path) const;
+  // Forget what has been printed and start a new set of statistics.
+  void clear_paper();
+
+ protected:
+  // Gives the fake printer the simulator's command table and input buffer level.
+  class Mechanism : public PrinterSimulator {
+   public:
+    using PrinterSimulator::param_count_;
+    uint32_t level() const { return this->pending_bytes_ + this->cmd_bytes_; }
+    uint32_t busy_until() const { return this->busy_until_; }
+    void retire(uint32_t t) { this->retire_(t); }
+  };
+
+  enum State : uint8_t { IDLE, SELECT, PARAMS, NUL_TERMINATED, DATA, RASTER };
+
+  void receive_(const uint8_t *data, size_t len);
+  void decode_(uint8_t c);
+  void command_();
+  void expect_data_(uint32_t len);
+  void answer_(uint8_t reply, bool in_order);
+  void print_line_();
+  void feed_(int rows);
+  void set_dot_(int x, int y);
+
+  uart::UARTComponent *uart_;
+  Mechanism mechanism_;
+  uint32_t baud_rate_;
+  bool paper_out_{false};
+  bool cover_open_{false};
+  bool overheated_{false};
+  bool answer_status_{true};
+  bool accept_baud_rate_{true};
+  MockPin *dtr_pin_{nullptr};
+  uint32_t dtr_threshold_{0};
+  bool dtr_enabled_{false};
+  std::deque<std::pair<uint32_t, uint8_t>> replies_{};  // GS r replies and when they are due
+
+  State state_{IDLE};
+  uint8_t cmd_[12];
+  uint8_t cmd_len_{0};
+  uint32_t remaining_{0};
+  uint16_t raster_width_{0};
+  uint16_t raster_rows_{0};
+  uint16_t raster_byte_{0};
+  uint32_t block_len_{0};  // Of the GS ( k block being decoded
+
+  std::string line_{};
+  uint8_t char_width_mul_{1};
+  uint8_t char_height_mul_{1};
+  uint8_t line_height_{30};
+  uint8_t justify_{0};
+
+  std::vector<uint8_t> paper_{};
+  std::vector<std::string> text_lines_{};
+  uint32_t last_print_time_{0};
+  uint32_t garbled_bytes_{0};
+  uint32_t status_queries_{0};
+  uint32_t qr_codes_{0};
+  uint32_t barcodes_{0};
+  uint32_t inits_{0};
+};
+
+}  // namespace thermal_printer
+}  // namespace esphome
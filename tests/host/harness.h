@@ -0,0 +1,87 @@
+#pragma once
+
+#include "esphome/components/uart/uart.h"
+#include "esphome/core/hal.h"
+
+#include "block_font.h"
+#include "check.h"
+#include "fake_printer.h"
+#include "thermal_printer.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace esphome {
+namespace thermal_printer {
+
+// The component wired to a fake printer through a stub UART, run on the simulated clock one loop()
+// pass per millisecond. Configure `display` and `printer` before setup().
+class Harness {
+ public:
+  explicit Harness(uint32_t baud_rate = 9600) {
+    this->uart.set_baud_rate(baud_rate);
+    this->printer.set_baud_rate(baud_rate);
+    this->display.set_uart_parent(&this->uart);
+  }
+
+  // setup(), then run until the printer has booted and taken the init sequence.
+  void setup() {
+    this->timed_([this] { this->display.setup(); });
+    for (int i = 0; i < 10000 && !this->display.is_ready(); i++)
+      this->step();
+    CHECK(this->display.is_ready());
+    CHECK(this->run_until_idle());
+    this->printer.clear_paper();
+    this->cpu_time_ = 0;
+  }
+
+  void step() {
+    this->timed_([this] { this->display.loop(); });
+    this->printer.update();
+    host::advance_time(1000);
+  }
+
+  void run_for(uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++)
+      this->step();
+  }
+
+  void update() {
+    this->timed_([this] { this->display.update(); });
+  }
+
+  // Run until no jobs are queued, the printer has printed everything and nothing but status queries
+  // has arrived for quiet_ms, counted from the call at the earliest so that a page has time to start.
+  // The component waits out a raster block's print time once it has sent the block, so it can stay
+  // quiet for seconds after the printer is done. False if not idle within max_ms.
+  bool run_until_idle(uint32_t max_ms = 600000, uint32_t quiet_ms = 5000) {
+    uint32_t start = millis();
+    for (uint32_t i = 0; i < max_ms; i++) {
+      this->step();
+      uint32_t last = std::max(start, this->printer.get_last_print_time() / 1000);
+      if (this->display.get_queued_jobs() == 0 && this->printer.is_idle() && millis() - last >= quiet_ms)
+        return true;
+    }
+    return false;
+  }
+
+  // Wall clock time (us) spent in the component's setup(), loop() and update() since setup().
+  uint64_t get_cpu_time() const { return this->cpu_time_; }
+
+  uart::UARTComponent uart;
+  FakePrinter printer{&uart};
+  ThermalPrinterDisplay display;
+
+ protected:
+  template<typename F> void timed_(F &&f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    this->cpu_time_ +=
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  uint64_t cpu_time_{0};
+};
+
+}  // namespace thermal_printer
+}  // namespace esphome
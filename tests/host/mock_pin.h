@@ -0,0 +1,50 @@
+#pragma once
+
+#include "esphome/core/gpio.h"
+
+namespace esphome {
+namespace thermal_printer {
+
+// A GPIO input whose level the test sets. Edges call the attached interrupt handler, as the
+// hardware would.
+class MockPin : public InternalGPIOPin {
+ public:
+  void setup() override { this->setup_called_ = true; }
+  bool digital_read() override { return this->level_; }
+  void digital_write(bool value) override { this->set_level(value); }
+  void detach_interrupt() const override { this->isr_ = nullptr; }
+  ISRInternalGPIOPin to_isr() const override { return ISRInternalGPIOPin(const_cast<bool *>(&this->level_)); }
+  uint8_t get_pin() const override { return 0; }
+
+  void set_level(bool level) {
+    if (level == this->level_)
+      return;
+    this->level_ = level;
+    this->edges_++;
+    bool rising = level;
+    if (this->isr_ != nullptr && (this->isr_type_ == gpio::INTERRUPT_ANY_EDGE ||
+                                  (rising && this->isr_type_ == gpio::INTERRUPT_RISING_EDGE) ||
+                                  (!rising && this->isr_type_ == gpio::INTERRUPT_FALLING_EDGE)))
+      this->isr_(this->isr_arg_);
+  }
+  bool has_interrupt() const { return this->isr_ != nullptr; }
+  bool was_set_up() const { return this->setup_called_; }
+  uint32_t get_edges() const { return this->edges_; }
+
+ protected:
+  void attach_interrupt(void (*func)(void *), void *arg, gpio::InterruptType type) const override {
+    this->isr_ = func;
+    this->isr_arg_ = arg;
+    this->isr_type_ = type;
+  }
+
+  bool level_{false};
+  bool setup_called_{false};
+  uint32_t edges_{0};
+  mutable void (*isr_)(void *){nullptr};
+  mutable void *isr_arg_{nullptr};
+  mutable gpio::InterruptType isr_type_{gpio::INTERRUPT_ANY_EDGE};
+};
+
+}  // namespace thermal_printer
+}  // namespace esphome
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "esphome/components/uart/uart.h"
+
+#include "thermal_printer.h"
+
+#include <vector>
+
+namespace esphome {
+namespace thermal_printer {
+
+// The component set up in full-page mode on a UART nothing listens to, for tests of what is drawn
+// into the page buffer rather than what is printed.
+class PageDisplay : public ThermalPrinterDisplay {
+ public:
+  explicit PageDisplay(int height) {
+    this->set_uart_parent(&this->uart_);
+    this->set_height(height);
+    this->setup();
+  }
+
+  std::vector<uint8_t> get_page() {
+    return std::vector<uint8_t>(this->buffer_, this->buffer_ + this->get_width() / 8 * this->get_height());
+  }
+
+ protected:
+  uart::UARTComponent uart_;
+};
+
+}  // namespace thermal_printer
+}  // namespace esphome
@@ -0,0 +1,343 @@
+#pragma once
+
+#include <algorithm>
+#include <cinttypes>
+#include <deque>
+#include <functional>
+#include <utility>
+
+namespace esphome {
+namespace thermal_printer {
+
+// The print mechanism behind FakePrinter. It follows the ESC/POS stream far enough to know what the
+// printer has to do with each byte, models the printer's input buffer and print mechanism, and keeps
+// statistics about the job: bytes and commands received, paper used, simulated print time and input
+// buffer overruns.
+//
+// The mechanism is modelled with the same timing figures the component paces itself by, so the
+// result shows whether the pacing keeps the input buffer from overflowing and how long a job takes
+// under those figures, not how a particular printer behaves.
+class PrinterSimulator {
+ public:
+  struct Stats {
+    uint32_t bytes{0};
+    uint32_t commands{0};  // Escape sequences, not counting text
+    uint32_t unknown_commands{0};
+    uint32_t text_lines{0};
+    uint32_t raster_rows{0};
+    uint32_t paper_rows{0};     // Dot rows printed or fed
+    uint32_t print_time{0};     // us from the first byte until the mechanism is done
+    uint32_t peak_level{0};     // Most bytes waiting in the input buffer at once
+    uint32_t overrun_bytes{0};  // Bytes that arrived while the input buffer was full
+  };
+
+  void set_input_buffer_size(uint32_t input_buffer_size) { this->input_buffer_size_ = input_buffer_size; }
+  uint32_t get_input_buffer_size() const { return this->input_buffer_size_; }
+  void set_byte_time(uint32_t byte_time) { this->byte_time_ = byte_time; }
+  void set_text_timing(uint32_t dot_print_time, uint32_t dot_feed_time) {
+    this->dot_print_time_ = dot_print_time;
+    this->dot_feed_time_ = dot_feed_time;
+  }
+  // Time to print one raster row with the given number of black dots
+  void set_row_time(std::function<uint32_t(uint16_t)> &&row_time) { this->row_time_ = std::move(row_time); }
+
+  // Bytes written to the UART at `now` (us), arriving one byte time apart.
+  void receive(const uint8_t *data, size_t len, uint32_t now) {
+    if (this->stats_.bytes == 0) {
+      this->start_ = now;
+      this->busy_until_ = now;
+    }
+    for (size_t i = 0; i < len; i++) {
+      uint32_t t = now + (i + 1) * this->byte_time_;
+      this->retire_(t);
+      this->cmd_bytes_++;
+      uint32_t level = this->pending_bytes_ + this->cmd_bytes_;
+      if (level > this->input_buffer_size_)
+        this->stats_.overrun_bytes++;
+      this->stats_.peak_level = std::max(this->stats_.peak_level, level);
+      this->stats_.bytes++;
+      this->process_(data[i], t);
+    }
+    this->stats_.print_time = this->busy_until_ - this->start_;
+  }
+
+  const Stats &stats() const { return this->stats_; }
+  bool active() const { return this->stats_.bytes != 0; }
+  // Start a new job. Decoder state and text settings carry over, as they would on the printer.
+  void reset_stats() { this->stats_ = Stats{}; }
+
+ protected:
+  enum State : uint8_t { IDLE, SELECT, PARAMS, NUL_TERMINATED, DATA, RASTER };
+
+  static const uint8_t ESC = 27;
+  static const uint8_t GS = 29;
+  static const uint8_t DC2 = 18;
+  static const uint8_t DLE = 16;
+
+  // Parameter bytes following a two byte command, 0xFF if unknown
+  static uint8_t param_count_(uint8_t prefix, uint8_t c) {
+    if (prefix == ESC) {
+      switch (c) {
+        case '@':
+        case '2':
+        case 'D':  // NUL terminated
+          return 0;
+        case '7':
+        case '*':
+          return 3;
+        case '8':
+        case '$':
+        case '\\':
+        case 'c':
+          return 2;
+        case '#':
+          return 9;  // # S B D R, then 4 bytes of baud rate
+        case '!':
+        case '3':
+        case 'd':
+        case 'J':
+        case '=':
+        case '-':
+        case 'E':
+        case 'G':
+        case '{':
+        case 'a':
+        case ' ':
+        case 'R':
+        case 't':
+        case 'V':
+          return 1;
+      }
+    } else if (prefix == GS) {
+      switch (c) {
+        case 'v':
+          return 6;  // 0 m xL xH yL yH
+        case '(':
+          return 3;  // Function, then pL pH and that many bytes
+        case '*':
+        case 'E':
+        case 'L':
+        case 'W':
+          return 2;
+        case '!':
+        case 'B':
+        case 'H':
+        case 'V':
+        case 'a':
+        case 'f':
+        case 'h':
+        case 'k':
+        case 'r':
+        case 'w':
+          return 1;
+      }
+    } else if (prefix == DC2) {
+      switch (c) {
+        case 'T':
+          return 0;
+        case '*':
+          return 2;
+        case '#':
+          return 1;
+      }
+    } else if (prefix == DLE) {
+      return 1;
+    }
+    return 0xFF;
+  }
+
+  void process_(uint8_t c, uint32_t t) {
+    switch (this->state_) {
+      case IDLE:
+        if (c == ESC || c == GS || c == DC2 || c == DLE) {
+          this->cmd_[0] = c;
+          this->cmd_len_ = 1;
+          this->state_ = SELECT;
+          this->stats_.commands++;
+        } else if (c == '\n') {
+          this->print_line_(t);
+        } else if (c >= ' ' && c != 0xFF) {
+          this->line_chars_++;
+        } else if (this->line_chars_ == 0) {
+          this->complete_(t, 0);  // NUL, wake, CR and the like
+        }
+        return;
+      case SELECT: {
+        this->cmd_[this->cmd_len_++] = c;
+        uint8_t params = param_count_(this->cmd_[0], c);
+        if (params == 0xFF) {
+          this->stats_.unknown_commands++;
+          params = 1;
+        }
+        if (this->cmd_[0] == ESC && c == 'D') {
+          this->state_ = NUL_TERMINATED;
+        } else if (params == 0) {
+          this->header_done_(t);
+        } else {
+          this->remaining_ = params;
+          this->state_ = PARAMS;
+        }
+        return;
+      }
+      case PARAMS:
+        if (this->cmd_len_ < sizeof(this->cmd_))
+          this->cmd_[this->cmd_len_++] = c;
+        if (--this->remaining_ == 0)
+          this->header_done_(t);
+        return;
+      case NUL_TERMINATED:
+        if (c == 0)
+          this->complete_(t, 0);
+        return;
+      case DATA:
+        if (--this->remaining_ == 0)
+          this->complete_(t, 0);
+        return;
+      case RASTER:
+        this->row_dots_ += __builtin_popcount(c);
+        if (++this->row_byte_ < this->raster_width_)
+          return;
+        this->stats_.raster_rows++;
+        this->stats_.paper_rows++;
+        this->complete_(t, this->row_time_ ? this->row_time_(this->row_dots_) : this->dot_print_time_);
+        this->row_byte_ = 0;
+        this->row_dots_ = 0;
+        if (--this->raster_rows_ > 0)
+          this->state_ = RASTER;
+        return;
+    }
+  }
+
+  // All fixed bytes of a command are in cmd_
+  void header_done_(uint32_t t) {
+    const uint8_t *p = this->cmd_ + 2;
+    uint32_t duration = 0;
+    if (this->cmd_[0] == ESC) {
+      switch (this->cmd_[1]) {
+        case '@':
+          this->char_height_ = 24;
+          this->line_height_ = 30;
+          break;
+        case '!':
+          this->char_height_ = (p[0] & 0x10) ? 48 : 24;
+          break;
+        case '3':
+          this->line_height_ = p[0];
+          break;
+        case 'd':
+          duration = p[0] * this->line_height_ * this->dot_feed_time_;
+          this->stats_.paper_rows += p[0] * this->line_height_;
+          break;
+        case 'J':
+          duration = p[0] * this->dot_feed_time_;
+          this->stats_.paper_rows += p[0];
+          break;
+        case '*':
+          return this->expect_data_(t, (p[1] | p[2] << 8) * (p[0] >= 32 ? 3 : 1));
+      }
+    } else if (this->cmd_[0] == GS) {
+      switch (this->cmd_[1]) {
+        case '!':
+          this->char_height_ = 24 * ((p[0] & 0x0F) + 1);
+          break;
+        case 'v':
+          this->raster_width_ = p[2] | p[3] << 8;
+          this->raster_rows_ = p[4] | p[5] << 8;
+          if (this->raster_width_ != 0 && this->raster_rows_ != 0) {
+            this->row_byte_ = 0;
+            this->row_dots_ = 0;
+            this->state_ = RASTER;
+            return;
+          }
+          break;
+        case 'k':
+          if (p[0] <= 6) {
+            this->state_ = NUL_TERMINATED;
+            return;
+          }
+          this->remaining_ = 1;
+          this->cmd_[1] = 'K';  // Length byte follows, then the data
+          this->state_ = PARAMS;
+          return;
+        case 'K':
+          return this->expect_data_(t, p[1]);
+        case '(':
+          return this->expect_data_(t, p[1] | p[2] << 8);
+        case '*':
+          return this->expect_data_(t, p[0] * p[1] * 8);
+      }
+    } else if (this->cmd_[0] == DC2 && this->cmd_[1] == '*') {
+      return this->expect_data_(t, p[0] * p[1]);
+    }
+    this->complete_(t, duration);
+  }
+
+  void expect_data_(uint32_t t, uint32_t len) {
+    if (len == 0)
+      return this->complete_(t, 0);
+    this->remaining_ = len;
+    this->state_ = DATA;
+  }
+
+  void print_line_(uint32_t t) {
+    uint32_t duration;
+    if (this->line_chars_ == 0) {
+      duration = this->line_height_ * this->dot_feed_time_;
+      this->stats_.paper_rows += this->line_height_;
+    } else {
+      uint32_t spacing = this->line_height_ > 24 ? this->line_height_ - 24 : 0;
+      duration = this->char_height_ * this->dot_print_time_ + spacing * this->dot_feed_time_;
+      this->stats_.paper_rows += this->char_height_ + spacing;
+      this->stats_.text_lines++;
+    }
+    this->line_chars_ = 0;
+    this->complete_(t, duration);
+  }
+
+  // The bytes received since the last command are one unit of work for the mechanism. They stay in
+  // the input buffer until it has done it.
+  void complete_(uint32_t t, uint32_t duration) {
+    if ((int32_t) (this->busy_until_ - t) < 0)
+      this->busy_until_ = t;
+    this->busy_until_ += duration;
+    this->pending_.emplace_back(this->busy_until_, this->cmd_bytes_);
+    this->pending_bytes_ += this->cmd_bytes_;
+    this->cmd_bytes_ = 0;
+    this->state_ = IDLE;
+  }
+
+  void retire_(uint32_t t) {
+    while (!this->pending_.empty() && (int32_t) (this->pending_.front().first - t) <= 0) {
+      this->pending_bytes_ -= this->pending_.front().second;
+      this->pending_.pop_front();
+    }
+  }
+
+  uint32_t input_buffer_size_{4096};
+  uint32_t byte_time_{1146};
+  uint32_t dot_print_time_{30000};
+  uint32_t dot_feed_time_{2100};
+  std::function<uint32_t(uint16_t)> row_time_{};
+
+  State state_{IDLE};
+  uint8_t cmd_[12];
+  uint8_t cmd_len_{0};
+  uint32_t remaining_{0};
+  uint32_t cmd_bytes_{0};  // Bytes of the command being decoded
+  uint16_t line_chars_{0};
+  uint16_t char_height_{24};
+  uint16_t line_height_{30};
+  uint16_t raster_width_{0};
+  uint16_t raster_rows_{0};
+  uint16_t row_byte_{0};
+  uint16_t row_dots_{0};
+
+  std::deque<std::pair<uint32_t, uint32_t>> pending_{};  // Finish time and size of commands in the input buffer
+  uint32_t pending_bytes_{0};
+  uint32_t start_{0};
+  uint32_t busy_until_{0};
+  Stats stats_{};
+};
+
+}  // namespace thermal_printer
+}  // namespace esphome
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "esphome/core/automation.h"
+#include "esphome/core/component.h"
+#include "esphome/core/defines.h"
+#include "esphome/core/optional.h"
+
+namespace esphome {
+
+struct Color {
+  uint8_t r, g, b, w;
+
+  Color() : r(0), g(0), b(0), w(0) {}
+  Color(uint8_t red, uint8_t green, uint8_t blue, uint8_t white = 0) : r(red), g(green), b(blue), w(white) {}
+  bool is_on() const { return this->r != 0 || this->g != 0 || this->b != 0 || this->w != 0; }
+};
+
+namespace display {
+
+extern const Color COLOR_OFF;
+extern const Color COLOR_ON;
+
+enum class TextAlign {
+  TOP = 0x00,
+  CENTER_VERTICAL = 0x01,
+  BASELINE = 0x02,
+  BOTTOM = 0x04,
+
+  LEFT = 0x00,
+  CENTER_HORIZONTAL = 0x08,
+  RIGHT = 0x10,
+
+  TOP_LEFT = TOP | LEFT,
+  TOP_CENTER = TOP | CENTER_HORIZONTAL,
+  TOP_RIGHT = TOP | RIGHT,
+  CENTER_LEFT = CENTER_VERTICAL | LEFT,
+  CENTER = CENTER_VERTICAL | CENTER_HORIZONTAL,
+  CENTER_RIGHT = CENTER_VERTICAL | RIGHT,
+  BASELINE_LEFT = BASELINE | LEFT,
+  BASELINE_CENTER = BASELINE | CENTER_HORIZONTAL,
+  BASELINE_RIGHT = BASELINE | RIGHT,
+  BOTTOM_LEFT = BOTTOM | LEFT,
+  BOTTOM_CENTER = BOTTOM | CENTER_HORIZONTAL,
+  BOTTOM_RIGHT = BOTTOM | RIGHT,
+};
+
+enum DisplayType {
+  DISPLAY_TYPE_BINARY = 1,
+  DISPLAY_TYPE_GRAYSCALE = 2,
+  DISPLAY_TYPE_COLOR = 3,
+};
+
+enum DisplayRotation {
+  DISPLAY_ROTATION_0_DEGREES = 0,
+  DISPLAY_ROTATION_90_DEGREES = 90,
+  DISPLAY_ROTATION_180_DEGREES = 180,
+  DISPLAY_ROTATION_270_DEGREES = 270,
+};
+
+class Rect {
+ public:
+  int16_t x{0};
+  int16_t y{0};
+  int16_t w{-1};
+  int16_t h{-1};
+
+  Rect() = default;
+  Rect(int16_t x, int16_t y, int16_t w, int16_t h) : x(x), y(y), w(w), h(h) {}
+  bool is_set() const { return this->w != -1 && this->h != -1; }
+  bool inside(int16_t test_x, int16_t test_y, bool absolute = true) const {
+    if (!this->is_set())
+      return true;
+    return test_x >= this->x && test_x < this->x + this->w && test_y >= this->y && test_y < this->y + this->h;
+  }
+};
+
+class Display;
+class DisplayPage;
+
+class BaseImage {
+ public:
+  virtual void draw(int x, int y, Display *display, Color color_on, Color color_off) = 0;
+  virtual int get_width() const = 0;
+  virtual int get_height() const = 0;
+};
+
+class BaseFont {
+ public:
+  virtual void print(int x, int y, Display *display, Color color, const char *text, Color background) = 0;
+  virtual void measure(const char *str, int *width, int *x_offset, int *baseline, int *height) = 0;
+};
+
+using display_writer_t = std::function<void(Display &)>;
+
+// The drawing primitives go pixel by pixel through draw_pixel_at(), as they do in ESPHome.
+class Display : public PollingComponent {
+ public:
+  virtual void fill(Color color);
+  void clear() { this->fill(COLOR_OFF); }
+  int get_width();
+  int get_height();
+
+  void draw_pixel_at(int x, int y) { this->draw_pixel_at(x, y, COLOR_ON); }
+  virtual void draw_pixel_at(int x, int y, Color color) = 0;
+  void line(int x1, int y1, int x2, int y2, Color color = COLOR_ON);
+  void horizontal_line(int x, int y, int width, Color color = COLOR_ON);
+  void vertical_line(int x, int y, int height, Color color = COLOR_ON);
+  void rectangle(int x1, int y1, int width, int height, Color color = COLOR_ON);
+  void filled_rectangle(int x1, int y1, int width, int height, Color color = COLOR_ON);
+  void print(int x, int y, BaseFont *font, Color color, TextAlign align, const char *text,
+             Color background = COLOR_OFF);
+  void print(int x, int y, BaseFont *font, Color color, const char *text) {
+    this->print(x, y, font, color, TextAlign::TOP_LEFT, text);
+  }
+  void print(int x, int y, BaseFont *font, const char *text) {
+    this->print(x, y, font, COLOR_ON, TextAlign::TOP_LEFT, text);
+  }
+  void image(int x, int y, BaseImage *image, Color color_on = COLOR_ON, Color color_off = COLOR_OFF) {
+    image->draw(x, y, this, color_on, color_off);
+  }
+  void get_text_bounds(int x, int y, const char *text, BaseFont *font, TextAlign align, int *x1, int *y1,
+                       int *width, int *height);
+
+  void set_writer(display_writer_t &&writer) { this->writer_ = writer; }
+  void set_rotation(DisplayRotation rotation) { this->rotation_ = rotation; }
+  void set_auto_clear(bool auto_clear_enable) { this->auto_clear_enabled_ = auto_clear_enable; }
+  virtual DisplayType get_display_type() = 0;
+
+  void start_clipping(Rect rect) { this->clipping_rectangle_.push_back(rect); }
+  void end_clipping() { this->clipping_rectangle_.pop_back(); }
+  Rect get_clipping() const {
+    return this->clipping_rectangle_.empty() ? Rect() : this->clipping_rectangle_.back();
+  }
+  bool is_clipping() const { return !this->clipping_rectangle_.empty(); }
+
+ protected:
+  virtual int get_height_internal() = 0;
+  virtual int get_width_internal() = 0;
+  void do_update_();
+  void clear_clipping_() { this->clipping_rectangle_.clear(); }
+
+  DisplayRotation rotation_{DISPLAY_ROTATION_0_DEGREES};
+  optional<display_writer_t> writer_{};
+  DisplayPage *page_{nullptr};
+  bool auto_clear_enabled_{true};
+  bool show_test_card_{false};
+  std::vector<Rect> clipping_rectangle_;
+};
+
+}  // namespace display
+}  // namespace esphome
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "esphome/components/display/display.h"
+#include "esphome/core/helpers.h"
+
+namespace esphome {
+namespace display {
+
+class DisplayBuffer : public Display {
+ public:
+  // Applies clipping and rotation, then hands the pixel to draw_absolute_pixel_internal().
+  void draw_pixel_at(int x, int y, Color color) override;
+
+ protected:
+  virtual void draw_absolute_pixel_internal(int x, int y, Color color) = 0;
+  void init_internal_(uint32_t buffer_length);
+
+  uint8_t *buffer_{nullptr};
+};
+
+}  // namespace display
+}  // namespace esphome
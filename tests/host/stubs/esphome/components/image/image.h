@@ -0,0 +1,39 @@
+#pragma once
+
+#include "esphome/components/display/display.h"
+
+namespace esphome {
+namespace image {
+
+enum ImageType {
+  IMAGE_TYPE_BINARY = 0,
+  IMAGE_TYPE_GRAYSCALE = 1,
+  IMAGE_TYPE_RGB24 = 2,
+  IMAGE_TYPE_RGB565 = 3,
+  IMAGE_TYPE_RGBA = 4,
+};
+
+// Binary images are packed MSB first with each row padded to whole bytes, grayscale images take a
+// byte per pixel and RGB24 images three, as the image component stores them.
+class Image : public display::BaseImage {
+ public:
+  Image(const uint8_t *data_start, int width, int height, ImageType type)
+      : width_(width), height_(height), type_(type), data_start_(data_start) {}
+
+  Color get_pixel(int x, int y, Color color_on = display::COLOR_ON, Color color_off = display::COLOR_OFF) const;
+  int get_width() const override { return this->width_; }
+  int get_height() const override { return this->height_; }
+  const uint8_t *get_data_start() const { return this->data_start_; }
+  ImageType get_type() const { return this->type_; }
+  bool has_transparency() const { return false; }
+  void draw(int x, int y, display::Display *display, Color color_on, Color color_off) override;
+
+ protected:
+  int width_;
+  int height_;
+  ImageType type_;
+  const uint8_t *data_start_;
+};
+
+}  // namespace image
+}  // namespace esphome
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+
+#include "esphome/core/helpers.h"
+
+namespace esphome {
+namespace text_sensor {
+
+class TextSensor {
+ public:
+  void publish_state(const std::string &state) {
+    this->state = state;
+    this->publishes++;
+  }
+
+  std::string state{};
+  int publishes{0};
+};
+
+}  // namespace text_sensor
+}  // namespace esphome
+
+#define SUB_TEXT_SENSOR(name) \
+ protected: \
+  text_sensor::TextSensor *name##_text_sensor_{nullptr}; \
+\
+ public: \
+  void set_##name##_text_sensor(text_sensor::TextSensor *text_sensor) { this->name##_text_sensor_ = text_sensor; }
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include "esphome/core/component.h"
+
+namespace esphome {
+namespace uart {
+
+enum UARTParityOptions {
+  UART_CONFIG_PARITY_NONE,
+  UART_CONFIG_PARITY_EVEN,
+  UART_CONFIG_PARITY_ODD,
+};
+
+// A UART whose TX side is handed to a callback and whose RX side is filled by the test.
+class UARTComponent {
+ public:
+  void write_array(const uint8_t *data, size_t len) {
+    if (this->tx_callback_)
+      this->tx_callback_(data, len);
+  }
+  bool peek_byte(uint8_t *data);
+  bool read_array(uint8_t *data, size_t len);
+  int available() { return this->rx_.size(); }
+  void flush() {}
+
+  void set_baud_rate(uint32_t baud_rate) { this->baud_rate_ = baud_rate; }
+  uint32_t get_baud_rate() const { return this->baud_rate_; }
+  uint8_t get_data_bits() const { return 8; }
+  uint8_t get_stop_bits() const { return 1; }
+  UARTParityOptions get_parity() const { return UART_CONFIG_PARITY_NONE; }
+  void load_settings(bool dump_config = true) {}
+
+  // Host side
+  void set_tx_callback(std::function<void(const uint8_t *, size_t)> &&callback) {
+    this->tx_callback_ = std::move(callback);
+  }
+  void inject_rx(uint8_t data) { this->rx_.push_back(data); }
+
+ protected:
+  uint32_t baud_rate_{9600};
+  std::function<void(const uint8_t *, size_t)> tx_callback_{};
+  std::deque<uint8_t> rx_{};
+};
+
+class UARTDevice {
+ public:
+  UARTDevice() = default;
+  UARTDevice(UARTComponent *parent) : parent_(parent) {}
+
+  void set_uart_parent(UARTComponent *parent) { this->parent_ = parent; }
+
+  void write_byte(uint8_t data) { this->parent_->write_array(&data, 1); }
+  void write_array(const uint8_t *data, size_t len) { this->parent_->write_array(data, len); }
+  void write_array(const std::vector<uint8_t> &data) { this->parent_->write_array(data.data(), data.size()); }
+  void write_str(const char *str);
+  bool read_byte(uint8_t *data) { return this->parent_->read_array(data, 1); }
+  bool peek_byte(uint8_t *data) { return this->parent_->peek_byte(data); }
+  bool read_array(uint8_t *data, size_t len) { return this->parent_->read_array(data, len); }
+  int available() { return this->parent_->available(); }
+  void flush() { this->parent_->flush(); }
+
+ protected:
+  UARTComponent *parent_{nullptr};
+};
+
+}  // namespace uart
+}  // namespace esphome
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+#define IRAM_ATTR
+#define HOT
+#define PROGMEM
+
+namespace esphome {
+
+// Simulated clock: it only moves when a test calls host::advance_time() or the component delays.
+uint32_t micros();
+uint32_t millis();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+inline uint8_t progmem_read_byte(const uint8_t *addr) { return *addr; }
+inline uint16_t progmem_read_uint16(const uint16_t *addr) { return *addr; }
+
+namespace host {
+void advance_time(uint32_t us);
+}  // namespace host
+
+}  // namespace esphome
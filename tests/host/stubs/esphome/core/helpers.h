@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "esphome/core/optional.h"
+
+namespace esphome {
+
+template<typename T> class Parented {
+ public:
+  Parented() {}
+  Parented(T *parent) : parent_(parent) {}
+  T *get_parent() const { return this->parent_; }
+  void set_parent(T *parent) { this->parent_ = parent; }
+
+ protected:
+  T *parent_{nullptr};
+};
+
+class HighFrequencyLoopRequester {
+ public:
+  void start() { this->started_ = true; }
+  void stop() { this->started_ = false; }
+
+ protected:
+  bool started_{false};
+};
+
+template<typename T> T clamp(T v, T lo, T hi) { return v < lo ? lo : (v > hi ? hi : v); }
+
+uint32_t fnv1_hash(const std::string &str);
+
+// Fills what it hands out with 0xA5, so code relying on memory arriving zeroed shows up in tests.
+template<class T> class ExternalRAMAllocator {
+ public:
+  using value_type = T;
+  enum Flags { NONE = 0, REFUSE_INTERNAL = 1 << 0, ALLOW_FAILURE = 1 << 1 };
+
+  ExternalRAMAllocator() = default;
+  ExternalRAMAllocator(Flags flags) {}
+
+  T *allocate(size_t n) {
+    T *p = static_cast<T *>(malloc(n * sizeof(T)));
+    if (p != nullptr)
+      memset(p, 0xA5, n * sizeof(T));
+    return p;
+  }
+  void deallocate(T *p, size_t n) { free(p); }
+};
+
+template<class T> class RAMAllocator : public ExternalRAMAllocator<T> {};
+
+template<typename T> class CallbackManager;
+
+template<typename... Ts> class CallbackManager<void(Ts...)> {
+ public:
+  void add(std::function<void(Ts...)> &&callback) { this->callbacks_.push_back(std::move(callback)); }
+  void call(Ts... args) {
+    for (auto &cb : this->callbacks_)
+      cb(args...);
+  }
+
+ protected:
+  std::vector<std::function<void(Ts...)>> callbacks_;
+};
+
+}  // namespace esphome
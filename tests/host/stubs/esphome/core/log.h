@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstdio>
+
+namespace esphome {
+namespace host {
+// Set by the THERMAL_PRINTER_LOG environment variable.
+extern bool log_enabled;
+}  // namespace host
+}  // namespace esphome
+
+#define ESP_LOG_HOST_(level, tag, ...) \
+  do { \
+    if (esphome::host::log_enabled) { \
+      printf("[%s][%s] ", level, tag); \
+      printf(__VA_ARGS__); \
+      printf("\n"); \
+    } \
+  } while (0)
+
+#define ESP_LOGE(tag, ...) ESP_LOG_HOST_("E", tag, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) ESP_LOG_HOST_("W", tag, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) ESP_LOG_HOST_("I", tag, __VA_ARGS__)
+#define ESP_LOGD(tag, ...) ESP_LOG_HOST_("D", tag, __VA_ARGS__)
+#define ESP_LOGV(tag, ...) ESP_LOG_HOST_("V", tag, __VA_ARGS__)
+#define ESP_LOGVV(tag, ...) ESP_LOG_HOST_("VV", tag, __VA_ARGS__)
+#define ESP_LOGCONFIG(tag, ...) ESP_LOG_HOST_("C", tag, __VA_ARGS__)
+
+#define LOG_PIN(prefix, pin)
+#define LOG_SENSOR(prefix, type, obj)
+#define LOG_TEXT_SENSOR(prefix, type, obj)
+#define LOG_BINARY_SENSOR(prefix, type, obj)
+#define LOG_DISPLAY(prefix, type, obj)
+#define LOG_UPDATE_INTERVAL(this)
+
+#define YESNO(b) ((b) ? "YES" : "NO")
+#define ONOFF(b) ((b) ? "ON" : "OFF")
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+
+// Nothing is persisted: loads fail, so the component starts from its defaults.
+class ESPPreferenceObject {
+ public:
+  template<typename T> bool save(const T *src) { return true; }
+  template<typename T> bool load(T *dest) { return false; }
+};
+
+class ESPPreferences {
+ public:
+  template<typename T> ESPPreferenceObject make_preference(uint32_t type, bool in_flash = false) { return {}; }
+};
+
+extern ESPPreferences *global_preferences;
+
+}  // namespace esphome
@@ -0,0 +1,30 @@
+#pragma once
+
+// Stand-in for the QR Code generator library. The symbol is a fixed pattern, not a real QR code,
+// sized by the data length the way the real encoder would roughly size it.
+
+#include <cstdint>
+#include <cstring>
+
+enum qrcodegen_Ecc { qrcodegen_Ecc_LOW = 0, qrcodegen_Ecc_MEDIUM, qrcodegen_Ecc_QUARTILE, qrcodegen_Ecc_HIGH };
+enum qrcodegen_Mask { qrcodegen_Mask_AUTO = -1 };
+
+#define qrcodegen_VERSION_MIN 1
+#define qrcodegen_VERSION_MAX 40
+#define qrcodegen_BUFFER_LEN_MAX 3918
+
+inline bool qrcodegen_encodeText(const char *text, uint8_t *temp_buffer, uint8_t *qrcode, enum qrcodegen_Ecc ecl,
+                                 int min_version, int max_version, enum qrcodegen_Mask mask, bool boost_ecl) {
+  size_t len = strlen(text);
+  if (len > 2953)
+    return false;
+  int version = 1 + len / 20;
+  qrcode[0] = 4 * (version > 40 ? 40 : version) + 17;
+  return true;
+}
+
+inline int qrcodegen_getSize(const uint8_t *qrcode) { return qrcode[0]; }
+
+inline bool qrcodegen_getModule(const uint8_t *qrcode, int x, int y) {
+  return (x < 7 && y < 7) || (x * y + x + y) % 3 == 0;
+}
@@ -0,0 +1,237 @@
+// Definitions behind the stub headers: the simulated clock, the pixel-by-pixel Display primitives
+// and the image decoder.
+
+#include "esphome/components/display/display_buffer.h"
+#include "esphome/components/image/image.h"
+#include "esphome/components/uart/uart.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "esphome/core/preferences.h"
+
+#include <cstdlib>
+#include <utility>
+
+namespace esphome {
+
+static uint32_t now_us = 0;
+
+uint32_t micros() { return now_us; }
+uint32_t millis() { return now_us / 1000; }
+void delay(uint32_t ms) { now_us += ms * 1000; }
+void delayMicroseconds(uint32_t us) { now_us += us; }
+void yield() {}
+
+namespace host {
+bool log_enabled = getenv("THERMAL_PRINTER_LOG") != nullptr;
+void advance_time(uint32_t us) { now_us += us; }
+}  // namespace host
+
+uint32_t fnv1_hash(const std::string &str) {
+  uint32_t hash = 2166136261UL;
+  for (char c : str) {
+    hash *= 16777619UL;
+    hash ^= c;
+  }
+  return hash;
+}
+
+ESPPreferences *global_preferences = new ESPPreferences();
+
+namespace display {
+
+const Color COLOR_OFF(0, 0, 0, 0);
+const Color COLOR_ON(255, 255, 255, 255);
+
+void Display::fill(Color color) { this->filled_rectangle(0, 0, this->get_width(), this->get_height(), color); }
+
+int Display::get_width() {
+  if (this->rotation_ == DISPLAY_ROTATION_90_DEGREES || this->rotation_ == DISPLAY_ROTATION_270_DEGREES)
+    return this->get_height_internal();
+  return this->get_width_internal();
+}
+
+int Display::get_height() {
+  if (this->rotation_ == DISPLAY_ROTATION_90_DEGREES || this->rotation_ == DISPLAY_ROTATION_270_DEGREES)
+    return this->get_width_internal();
+  return this->get_height_internal();
+}
+
+void Display::line(int x1, int y1, int x2, int y2, Color color) {
+  const int dx = abs(x2 - x1), sx = x1 < x2 ? 1 : -1;
+  const int dy = -abs(y2 - y1), sy = y1 < y2 ? 1 : -1;
+  int err = dx + dy;
+  while (true) {
+    this->draw_pixel_at(x1, y1, color);
+    if (x1 == x2 && y1 == y2)
+      break;
+    int e2 = 2 * err;
+    if (e2 >= dy) {
+      err += dy;
+      x1 += sx;
+    }
+    if (e2 <= dx) {
+      err += dx;
+      y1 += sy;
+    }
+  }
+}
+
+void Display::horizontal_line(int x, int y, int width, Color color) {
+  for (int i = x; i < x + width; i++)
+    this->draw_pixel_at(i, y, color);
+}
+
+void Display::vertical_line(int x, int y, int height, Color color) {
+  for (int i = y; i < y + height; i++)
+    this->draw_pixel_at(x, i, color);
+}
+
+void Display::rectangle(int x1, int y1, int width, int height, Color color) {
+  this->horizontal_line(x1, y1, width, color);
+  this->horizontal_line(x1, y1 + height - 1, width, color);
+  this->vertical_line(x1, y1, height, color);
+  this->vertical_line(x1 + width - 1, y1, height, color);
+}
+
+void Display::filled_rectangle(int x1, int y1, int width, int height, Color color) {
+  for (int i = y1; i < y1 + height; i++)
+    this->horizontal_line(x1, i, width, color);
+}
+
+void Display::print(int x, int y, BaseFont *font, Color color, TextAlign align, const char *text, Color background) {
+  int x_start, y_start, width, height;
+  this->get_text_bounds(x, y, text, font, align, &x_start, &y_start, &width, &height);
+  font->print(x_start, y_start, this, color, text, background);
+}
+
+void Display::get_text_bounds(int x, int y, const char *text, BaseFont *font, TextAlign align, int *x1, int *y1,
+                              int *width, int *height) {
+  int x_offset, baseline;
+  font->measure(text, width, &x_offset, &baseline, height);
+  switch (static_cast<TextAlign>(static_cast<int>(align) & 0x18)) {
+    case TextAlign::RIGHT:
+      *x1 = x - *width;
+      break;
+    case TextAlign::CENTER_HORIZONTAL:
+      *x1 = x - (*width) / 2;
+      break;
+    default:
+      *x1 = x;
+      break;
+  }
+  switch (static_cast<TextAlign>(static_cast<int>(align) & 0x07)) {
+    case TextAlign::BOTTOM:
+      *y1 = y - *height;
+      break;
+    case TextAlign::BASELINE:
+      *y1 = y - baseline;
+      break;
+    case TextAlign::CENTER_VERTICAL:
+      *y1 = y - (*height) / 2;
+      break;
+    default:
+      *y1 = y;
+      break;
+  }
+}
+
+void Display::do_update_() {
+  if (this->auto_clear_enabled_)
+    this->clear();
+  if (this->writer_.has_value())
+    (*this->writer_)(*this);
+  this->clear_clipping_();
+}
+
+void DisplayBuffer::draw_pixel_at(int x, int y, Color color) {
+  if (!this->get_clipping().inside(x, y))
+    return;
+  switch (this->rotation_) {
+    case DISPLAY_ROTATION_0_DEGREES:
+      break;
+    case DISPLAY_ROTATION_90_DEGREES:
+      std::swap(x, y);
+      x = this->get_width_internal() - x - 1;
+      break;
+    case DISPLAY_ROTATION_180_DEGREES:
+      x = this->get_width_internal() - x - 1;
+      y = this->get_height_internal() - y - 1;
+      break;
+    case DISPLAY_ROTATION_270_DEGREES:
+      std::swap(x, y);
+      y = this->get_height_internal() - y - 1;
+      break;
+  }
+  this->draw_absolute_pixel_internal(x, y, color);
+}
+
+void DisplayBuffer::init_internal_(uint32_t buffer_length) {
+  ExternalRAMAllocator<uint8_t> allocator(ExternalRAMAllocator<uint8_t>::ALLOW_FAILURE);
+  this->buffer_ = allocator.allocate(buffer_length);
+  if (this->buffer_ == nullptr)
+    return;
+  this->clear();
+}
+
+}  // namespace display
+
+namespace image {
+
+Color Image::get_pixel(int x, int y, Color color_on, Color color_off) const {
+  if (x < 0 || x >= this->width_ || y < 0 || y >= this->height_)
+    return color_off;
+  switch (this->type_) {
+    case IMAGE_TYPE_BINARY: {
+      const uint8_t *row = this->data_start_ + y * ((this->width_ + 7) / 8);
+      return (row[x / 8] & (0x80 >> (x % 8))) ? color_on : color_off;
+    }
+    case IMAGE_TYPE_GRAYSCALE: {
+      uint8_t v = this->data_start_[y * this->width_ + x];
+      return Color(v, v, v);
+    }
+    case IMAGE_TYPE_RGB24: {
+      const uint8_t *p = this->data_start_ + 3 * (y * this->width_ + x);
+      return Color(p[0], p[1], p[2]);
+    }
+    default:
+      return color_off;
+  }
+}
+
+void Image::draw(int x, int y, display::Display *display, Color color_on, Color color_off) {
+  for (int img_y = 0; img_y < this->height_; img_y++) {
+    for (int img_x = 0; img_x < this->width_; img_x++) {
+      display->draw_pixel_at(x + img_x, y + img_y, this->get_pixel(img_x, img_y, color_on, color_off));
+    }
+  }
+}
+
+}  // namespace image
+
+namespace uart {
+
+bool UARTComponent::peek_byte(uint8_t *data) {
+  if (this->rx_.empty())
+    return false;
+  *data = this->rx_.front();
+  return true;
+}
+
+bool UARTComponent::read_array(uint8_t *data, size_t len) {
+  if (this->rx_.size() < len)
+    return false;
+  for (size_t i = 0; i < len; i++) {
+    data[i] = this->rx_.front();
+    this->rx_.pop_front();
+  }
+  return true;
+}
+
+void UARTDevice::write_str(const char *str) {
+  this->parent_->write_array(reinterpret_cast<const uint8_t *>(str), strlen(str));
+}
+
+}  // namespace uart
+
+}  // namespace esphome
@@ -0,0 +1,34 @@
+// The baud rate upgrade at startup: both sides end up at the new rate when the printer takes the
+// command, and back at the old one when it ignores it or the check gets no answer. Text prints
+// intact afterwards either way.
+
+#include "harness.h"
+
+using namespace esphome;
+using namespace esphome::thermal_printer;
+
+struct Printer {
+  bool accept_baud_rate;
+  bool answer_status;
+  uint32_t expected_baud_rate;
+};
+
+int main() {
+  for (Printer printer : {Printer{true, true, 115200}, Printer{false, true, 9600}, Printer{true, false, 9600}}) {
+    Harness h;
+    h.display.set_upgrade_baud_rate(115200);
+    h.printer.set_accept_baud_rate(printer.accept_baud_rate);
+    h.printer.set_answer_status(printer.answer_status);
+    h.setup();
+    CHECK_EQ(h.uart.get_baud_rate(), printer.expected_baud_rate);
+    CHECK_EQ(h.printer.get_baud_rate(), printer.expected_baud_rate);
+
+    h.display.enqueue_text("Hello world\nSecond line\n");
+    CHECK(h.run_until_idle());
+    CHECK_EQ(h.printer.get_garbled_bytes(), 0);
+    CHECK_EQ(h.printer.get_text_lines().size(), 2);
+    CHECK(h.printer.get_text_lines()[0] == "Hello world");
+    CHECK(h.printer.get_text_lines()[1] == "Second line");
+  }
+  return 0;
+}
@@ -0,0 +1,77 @@
+// With a DTR pin the component sends only while the printer holds the pin low, and then as fast as
+// the UART allows rather than at the pace of its print time estimates.
+
+#include "check.h"
+#include "mock_pin.h"
+
+#include "esphome/components/uart/uart.h"
+#include "esphome/core/hal.h"
+
+#include "thermal_printer.h"
+
+#include <string>
+
+using namespace esphome;
+using namespace esphome::thermal_printer;
+
+static std::string sent;
+
+// print_text() resets the printer's text settings before the text
+static bool ends_with(const std::string &s, const std::string &suffix) {
+  return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static void run_for(ThermalPrinterDisplay &display, uint32_t ms) {
+  for (uint32_t i = 0; i < ms; i++) {
+    display.loop();
+    host::advance_time(1000);
+  }
+}
+
+int main() {
+  uart::UARTComponent uart;
+  uart.set_tx_callback([](const uint8_t *data, size_t len) { sent.append((const char *) data, len); });
+  MockPin pin;
+  ThermalPrinterDisplay display;
+  display.set_uart_parent(&uart);
+  display.set_dtr_pin(&pin);
+  display.setup();
+  CHECK(pin.was_set_up());
+  CHECK(pin.has_interrupt());
+
+  // The init sequence tells the printer to signal busy on DTR
+  run_for(display, 5000);
+  CHECK(sent.find(std::string{29, 'a', 1 << 5}) != std::string::npos);
+
+  // Nothing goes out while the printer is busy
+  sent.clear();
+  pin.set_level(true);
+  std::string text;
+  for (int i = 0; i < 20; i++)
+    text += "Line " + std::to_string(i) + "\n";
+  display.print_text(text);
+  run_for(display, 2000);
+  CHECK(sent.empty());
+
+  // Once it is ready the lines follow each other at UART speed, with no pauses for the estimated
+  // print time in between
+  pin.set_level(false);
+  run_for(display, 5);
+  CHECK(!sent.empty());
+  run_for(display, 500);
+  CHECK(ends_with(sent, text));
+
+  // Busy again halfway through
+  sent.clear();
+  display.print_text(text);
+  run_for(display, 50);
+  pin.set_level(true);
+  size_t before = sent.size();
+  CHECK(before > 0 && before < text.size());
+  run_for(display, 1000);
+  CHECK_EQ(sent.size(), before);
+  pin.set_level(false);
+  run_for(display, 500);
+  CHECK(ends_with(sent, text));
+  return 0;
+}
@@ -0,0 +1,66 @@
+// Text drawn through the glyph cache leaves the page exactly as the font drawing it pixel by pixel
+// does, at any alignment, in white on black and at the paper edges.
+
+#include "block_font.h"
+#include "check.h"
+#include "page_display.h"
+
+#include <string>
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::thermal_printer;
+
+static const int HEIGHT = 300;
+
+static BlockFont font;
+
+// Draw through print_cached() or, for the reference, the font's own print().
+static void draw(ThermalPrinterDisplay &it, bool cached) {
+  auto text = [&](int x, int y, Color color, display::TextAlign align, const char *s) {
+    if (cached) {
+      it.print_cached(x, y, &font, color, align, s);
+    } else {
+      it.print(x, y, &font, color, align, s);
+    }
+  };
+  const int width = it.get_width();
+  it.fill(display::COLOR_OFF);
+  text(width / 2, 0, display::COLOR_ON, display::TextAlign::TOP_CENTER, "Receipt 0042");
+  for (int i = 0; i < 8; i++) {
+    // Odd x offsets so glyphs straddle bytes
+    std::string item = "Item " + std::to_string(i);
+    text(3 + i, 24 + i * 20, display::COLOR_ON, display::TextAlign::TOP_LEFT, item.c_str());
+    text(width - 1, 40 + i * 20, display::COLOR_ON, display::TextAlign::BASELINE_RIGHT, "12.50");
+  }
+  it.filled_rectangle(0, 200, width, 40);
+  text(width / 2, 220, display::COLOR_OFF, display::TextAlign::CENTER, "TOTAL 100.00");
+  // Partly off the paper on either side and at the bottom
+  text(-5, 250, display::COLOR_ON, display::TextAlign::TOP_LEFT, "Left");
+  text(width + 5, 250, display::COLOR_ON, display::TextAlign::TOP_RIGHT, "Right");
+  text(100, HEIGHT - 8, display::COLOR_ON, display::TextAlign::TOP_LEFT, "Bottom");
+  // Clipped, which print_cached() leaves to print()
+  it.start_clipping(display::Rect(60, 270, 50, 10));
+  text(50, 265, display::COLOR_ON, display::TextAlign::TOP_LEFT, "Clipped");
+  it.end_clipping();
+}
+
+int main() {
+  PageDisplay page(HEIGHT);
+  // Mark the whole page drawn, so fill() clears all of it
+  page.fill(display::COLOR_ON);
+
+  draw(page, false);
+  std::vector<uint8_t> reference = page.get_page();
+  int dots = 0;
+  for (uint8_t byte : reference)
+    dots += __builtin_popcount(byte);
+  CHECK(dots > 1000);
+
+  draw(page, true);
+  CHECK(page.get_page() == reference);
+  // Again, from glyphs cached the first time
+  draw(page, true);
+  CHECK(page.get_page() == reference);
+  return 0;
+}
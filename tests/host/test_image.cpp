@@ -0,0 +1,75 @@
+// Binary images go to the printer straight from the image data: each row centred with a blank margin,
+// its padding bits as they are and wider images cropped to the paper. The rows come out whole
+// however loop() passes and maxChunkHeight split them, between the jobs around them.
+
+#include "harness.h"
+
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::thermal_printer;
+
+static const size_t ROW_BYTES = FakePrinter::ROW_BYTES;
+static const int TEXT_LINE_HEIGHT = 30;  // ESC @ default
+
+struct Setup {
+  uint32_t baud_rate;
+  uint8_t max_chunk_height;
+  uint32_t max_loop_time;
+};
+
+// A pattern with the padding bits of each row clear, as the image component stores them
+static std::vector<uint8_t> make_image(int width, int height) {
+  size_t stride = (width + 7) / 8;
+  std::vector<uint8_t> data(stride * height);
+  uint32_t seed = 1;
+  for (int y = 0; y < height; y++) {
+    for (size_t i = 0; i < stride; i++) {
+      seed = seed * 1103515245 + 12345;
+      data[stride * y + i] = seed >> 16;
+    }
+    if (width % 8 != 0)
+      data[stride * y + stride - 1] &= 0xFF << (8 - width % 8);
+  }
+  return data;
+}
+
+static void print_image(const Setup &setup, int width, int height) {
+  std::vector<uint8_t> data = make_image(width, height);
+  image::Image image(data.data(), width, height, image::IMAGE_TYPE_BINARY);
+  Harness h(setup.baud_rate);
+  h.display.set_max_chunk_height(setup.max_chunk_height);
+  h.display.set_max_loop_time(setup.max_loop_time);
+  h.setup();
+
+  CHECK(h.display.enqueue_text("before\n"));
+  CHECK(h.display.enqueue_image(&image));
+  CHECK(h.display.enqueue_text("after\n"));
+  CHECK(h.run_until_idle());
+  CHECK_EQ(h.printer.get_garbled_bytes(), 0);
+  CHECK_EQ(h.printer.stats().unknown_commands, 0);
+  CHECK_EQ(h.printer.get_text_lines().size(), 2);
+  CHECK(h.printer.get_text_lines()[0] == "before");
+  CHECK(h.printer.get_text_lines()[1] == "after");
+
+  // The image starts right below the first line and the second follows right after it
+  size_t stride = (width + 7) / 8;
+  size_t cropped = std::min(stride, ROW_BYTES);
+  size_t margin = (ROW_BYTES - cropped) / 2;
+  int top = TEXT_LINE_HEIGHT;
+  CHECK_EQ(h.printer.get_paper_rows(), top + height + TEXT_LINE_HEIGHT);
+  for (int y = 0; y < height; y++) {
+    uint8_t expected[ROW_BYTES] = {};
+    memcpy(expected + margin, &data[stride * y], cropped);
+    CHECK(memcmp(h.printer.get_row(top + y), expected, ROW_BYTES) == 0);
+  }
+}
+
+int main() {
+  // One row per pass at 9600 baud, several at 115200; blocks of 255 rows, or a few rows each
+  for (Setup setup : {Setup{9600, 255, 20}, Setup{115200, 255, 20}, Setup{115200, 7, 1}, Setup{115200, 1, 20}}) {
+    print_image(setup, 203, 300);  // Centred, with padding bits
+    print_image(setup, 400, 20);   // Cropped
+  }
+  return 0;
+}
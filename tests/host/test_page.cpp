@@ -0,0 +1,56 @@
+// Pages print the same whether rendered in full, in bands or double buffered, with blank rows fed
+// rather than sent.
+
+#include "harness.h"
+
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::thermal_printer;
+
+static const int WIDTH = FakePrinter::PAPER_WIDTH;
+
+static void draw(ThermalPrinterDisplay &it) {
+  it.filled_rectangle(10, 20, 100, 30);
+  it.filled_rectangle(0, 200, 50, 5);
+  it.horizontal_line(0, 299, WIDTH);
+}
+
+struct Mode {
+  uint16_t band_height;
+  bool double_buffer;
+};
+
+int main() {
+  std::vector<std::vector<uint8_t>> results;
+  for (Mode mode : {Mode{0, false}, Mode{64, false}, Mode{0, true}}) {
+    Harness h;
+    h.display.set_height(300);
+    h.display.set_band_height(mode.band_height);
+    h.display.set_double_buffer(mode.double_buffer);
+    h.display.set_writer(draw);
+    h.setup();
+
+    h.update();
+    CHECK(h.run_until_idle());
+    FakePrinter &p = h.printer;
+    CHECK_EQ(p.get_paper_rows(), 300);
+    CHECK_EQ(p.count_dots(10, 20, 110, 50), 100 * 30);
+    CHECK_EQ(p.count_dots(0, 200, 50, 205), 50 * 5);
+    CHECK_EQ(p.count_dots(0, 299, WIDTH, 300), WIDTH);
+    CHECK_EQ(p.count_dots(0, 0, WIDTH, 300), 100 * 30 + 50 * 5 + WIDTH);
+    // Only the 36 rows with something on them go out as raster
+    CHECK_EQ(p.stats().raster_rows, 30 + 5 + 1);
+    CHECK_EQ(p.stats().overrun_bytes, 0);
+
+    // A second page prints like the first
+    p.clear_paper();
+    h.update();
+    CHECK(h.run_until_idle());
+    CHECK_EQ(p.count_dots(0, 0, WIDTH, 300), 100 * 30 + 50 * 5 + WIDTH);
+    results.emplace_back(p.get_row(0), p.get_row(0) + 300 * FakePrinter::ROW_BYTES);
+  }
+  CHECK(results[1] == results[0]);
+  CHECK(results[2] == results[0]);
+  return 0;
+}
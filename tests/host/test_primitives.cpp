@@ -0,0 +1,78 @@
+// The byte-wide fill, line and rectangle primitives leave the page exactly as the pixel-by-pixel
+// DisplayBuffer versions do, including at the paper edges, when clipped and when drawing white.
+
+#include "check.h"
+#include "page_display.h"
+
+#include <cstdlib>
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::thermal_printer;
+
+static const int HEIGHT = 200;
+
+struct Shape {
+  int kind;
+  int x, y, w, h;
+  bool on;
+};
+
+static std::vector<Shape> random_shapes(unsigned seed, int width) {
+  srand(seed);
+  std::vector<Shape> shapes;
+  for (int i = 0; i < 300; i++) {
+    Shape s;
+    s.kind = rand() % 3;
+    s.x = rand() % (width + 40) - 20;
+    s.y = rand() % (HEIGHT + 40) - 20;
+    s.w = rand() % 120 - 10;
+    s.h = rand() % 60 - 5;
+    s.on = rand() % 4 != 0;
+    shapes.push_back(s);
+  }
+  return shapes;
+}
+
+// Draw through `D`: ThermalPrinterDisplay for the byte-wide versions, display::Display for the
+// pixel-by-pixel ones.
+template<typename D> static void draw(D &it, const std::vector<Shape> &shapes) {
+  const int width = it.get_width();
+  it.D::fill(display::COLOR_OFF);
+  it.filled_rectangle(0, 150, width, 50);
+  it.start_clipping(display::Rect(37, 140, 201, 45));
+  it.filled_rectangle(0, 130, width, 70, display::COLOR_OFF);
+  it.end_clipping();
+  for (const Shape &s : shapes) {
+    Color color = s.on ? display::COLOR_ON : display::COLOR_OFF;
+    switch (s.kind) {
+      case 0:
+        it.filled_rectangle(s.x, s.y, s.w, s.h, color);
+        break;
+      case 1:
+        it.horizontal_line(s.x, s.y, s.w, color);
+        break;
+      case 2:
+        it.vertical_line(s.x, s.y, s.h, color);
+        break;
+    }
+  }
+}
+
+int main() {
+  PageDisplay page(HEIGHT);
+  CHECK(page.get_page() == std::vector<uint8_t>(page.get_width() / 8 * HEIGHT, 0x00));
+  for (unsigned seed = 1; seed <= 5; seed++) {
+    std::vector<Shape> shapes = random_shapes(seed, page.get_width());
+    draw<ThermalPrinterDisplay>(page, shapes);
+    std::vector<uint8_t> fast = page.get_page();
+    draw<display::Display>(page, shapes);
+    std::vector<uint8_t> reference = page.get_page();
+    CHECK(fast == reference);
+  }
+  page.fill(display::COLOR_ON);
+  CHECK(page.get_page() == std::vector<uint8_t>(page.get_width() / 8 * HEIGHT, 0xFF));
+  page.fill(display::COLOR_OFF);
+  CHECK(page.get_page() == std::vector<uint8_t>(page.get_width() / 8 * HEIGHT, 0x00));
+  return 0;
+}
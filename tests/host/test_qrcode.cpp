@@ -0,0 +1,48 @@
+// QR codes printed as raster on firmware without GS ( k: a module row has to go out as one block,
+// so with a small transmit buffer the module size comes down until it fits, and the job doesn't
+// hold up the ones behind it.
+
+#include "harness.h"
+
+using namespace esphome;
+using namespace esphome::thermal_printer;
+
+// Width in dots of what was printed, or 0 if nothing was
+static int printed_width(const FakePrinter &printer) {
+  int left = FakePrinter::PAPER_WIDTH, right = 0;
+  for (int y = 0; y < printer.get_paper_rows(); y++) {
+    for (int x = 0; x < FakePrinter::PAPER_WIDTH; x++) {
+      if (printer.get_dot(x, y)) {
+        left = std::min(left, x);
+        right = std::max(right, x + 1);
+      }
+    }
+  }
+  return std::max(right - left, 0);
+}
+
+static int print_qrcode(size_t tx_buffer_size) {
+  Harness h;
+  h.display.set_tx_buffer_size(tx_buffer_size);
+  h.display.set_qr_module_size(8);
+  h.display.set_firmware(268);
+  h.setup();
+
+  CHECK(h.display.enqueue_qrcode("hello"));
+  CHECK(h.display.enqueue_text("after\n"));
+  CHECK(h.run_until_idle());
+  CHECK_EQ(h.printer.get_garbled_bytes(), 0);
+  CHECK_EQ(h.printer.stats().overrun_bytes, 0);
+  CHECK_EQ(h.display.get_tx_dropped(), 0);
+  CHECK_EQ(h.printer.get_text_lines().size(), 1);
+  CHECK(h.printer.get_text_lines()[0] == "after");
+  return printed_width(h.printer);
+}
+
+int main() {
+  int full = print_qrcode(4096);
+  int small = print_qrcode(256);
+  CHECK(small > 0);
+  CHECK(small < full);
+  return 0;
+}
@@ -0,0 +1,108 @@
+// Receipts: lines the selected code page can encode go out as text, the rest as raster through the
+// receipt font, aligned, underlined and as high as the printer would print them.
+
+#include "harness.h"
+
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::thermal_printer;
+
+static const int WIDTH = FakePrinter::PAPER_WIDTH;
+static const size_t ROW_BYTES = FakePrinter::ROW_BYTES;
+// Receipts keep the component's line height of 24 dots, so lines follow each other without spacing
+static const int TEXT_LINE_HEIGHT = FakePrinter::CHAR_HEIGHT;
+
+// A line of `text` as BlockFont draws it, at x in rows of ROW_BYTES, each dot y_scale rows high.
+static std::vector<uint8_t> block_font_line(const std::string &text, int x, int y_scale, bool underline) {
+  int rows = BlockFont::HEIGHT * y_scale;
+  std::vector<uint8_t> raster(ROW_BYTES * rows, 0);
+  auto set = [&](int dx, int y) { raster[ROW_BYTES * y + dx / 8] |= 0x80 >> (dx % 8); };
+  for (size_t i = 0; i < text.size(); i++) {
+    unsigned c = (uint8_t) text[i];
+    for (int row = 4; row < 18; row++) {
+      for (int col = 1; col < 10; col++) {
+        if ((c * 7 + row * 3 + col * 5) % 4 != 0)
+          continue;
+        for (int dy = 0; dy < y_scale; dy++)
+          set(x + BlockFont::ADVANCE * i + col, row * y_scale + dy);
+      }
+    }
+  }
+  if (underline) {
+    for (int dy = 0; dy < y_scale; dy++) {
+      for (size_t dx = 0; dx < BlockFont::ADVANCE * text.size(); dx++)
+        set(x + dx, (BlockFont::BASELINE + 1) * y_scale + dy);
+    }
+  }
+  return raster;
+}
+
+// Compare the paper from row `top` with a raster line, bit for bit.
+static void check_raster_line(const FakePrinter &printer, int top, const std::vector<uint8_t> &raster) {
+  int rows = raster.size() / ROW_BYTES;
+  CHECK(top + rows <= printer.get_paper_rows());
+  for (int y = 0; y < rows; y++)
+    CHECK(memcmp(printer.get_row(top + y), &raster[ROW_BYTES * y], ROW_BYTES) == 0);
+}
+
+int main() {
+  const std::string cjk = "\xE6\x97\xA5\xE6\x9C\xAC";  // 日本
+  const std::string han = "\xE4\xB8\xAD";               // 中
+
+  // CP858 has é and €, so only the CJK lines need the font
+  {
+    BlockFont font;
+    Harness h;
+    h.display.set_receipt_font(&font);
+    h.display.set_code_page(19);
+    h.setup();
+    CHECK(h.display.enqueue_receipt({
+        {"Total", RECEIPT_BOLD, 'L'},
+        {"Caf\xC3\xA9 \xE2\x82\xAC", 0, 'C'},
+        {cjk, RECEIPT_UNDERLINE, 'R'},
+        {han, RECEIPT_DOUBLE_HEIGHT, 'C'},
+        {"end", 0, 'L'},
+    }));
+    CHECK(h.run_until_idle());
+    CHECK_EQ(h.printer.get_garbled_bytes(), 0);
+    CHECK_EQ(h.printer.stats().unknown_commands, 0);
+
+    const auto &lines = h.printer.get_text_lines();
+    CHECK_EQ(lines.size(), 3);
+    CHECK(lines[0] == "Total");
+    CHECK(lines[1] == "Caf\x82 \xD5");
+    CHECK(lines[2] == "end");
+
+    // Text lines are as high as the printer's characters, raster lines as the font
+    int cjk_top = 2 * TEXT_LINE_HEIGHT;
+    int han_top = cjk_top + BlockFont::HEIGHT;
+    int end_top = han_top + 2 * BlockFont::HEIGHT;
+    CHECK_EQ(h.printer.get_paper_rows(), end_top + TEXT_LINE_HEIGHT);
+
+    // Right aligned and underlined; centred and twice as high
+    int cjk_width = BlockFont::ADVANCE * cjk.size();
+    check_raster_line(h.printer, cjk_top, block_font_line(cjk, WIDTH - cjk_width, 1, true));
+    CHECK_EQ(h.printer.count_dots(WIDTH - cjk_width, cjk_top + BlockFont::BASELINE + 1, WIDTH,
+                                  cjk_top + BlockFont::BASELINE + 2),
+             cjk_width);
+    int han_width = BlockFont::ADVANCE * han.size();
+    check_raster_line(h.printer, han_top, block_font_line(han, (WIDTH - han_width) / 2, 2, false));
+    CHECK_EQ(h.printer.count_dots(0, han_top + 2 * BlockFont::HEIGHT, WIDTH, end_top), 0);
+  }
+
+  // CP437 has é but no €, so that line is drawn too
+  {
+    BlockFont font;
+    Harness h;
+    h.display.set_receipt_font(&font);
+    h.setup();
+    CHECK(h.display.enqueue_receipt({{"Caf\xC3\xA9", 0, 'L'}, {"Caf\xC3\xA9 \xE2\x82\xAC", 0, 'L'}}));
+    CHECK(h.run_until_idle());
+    CHECK_EQ(h.printer.get_text_lines().size(), 1);
+    CHECK(h.printer.get_text_lines()[0] == "Caf\x82");
+    CHECK_EQ(h.printer.get_paper_rows(), TEXT_LINE_HEIGHT + BlockFont::HEIGHT);
+    check_raster_line(h.printer, TEXT_LINE_HEIGHT, block_font_line("Caf\xC3\xA9 \xE2\x82\xAC", 0, 1, false));
+  }
+  return 0;
+}
@@ -0,0 +1,106 @@
+// Status polling: output holds while the printer reports paper out, cover open or an overheated
+// head, the binary sensors follow the printer, and the job finishes once it can print again. A
+// printer reporting it has worked through a barcode lets the next line go out early.
+
+#include "harness.h"
+
+#include <string>
+
+using namespace esphome;
+using namespace esphome::thermal_printer;
+
+static const int LINES = 40;
+
+static std::string receipt() {
+  std::string text;
+  for (int i = 0; i < LINES; i++)
+    text += "Item " + std::to_string(i) + "\n";
+  return text;
+}
+
+struct Sensors {
+  binary_sensor::BinarySensor paper_out, cover_open, overheated;
+};
+
+// The printer's input buffer lags behind the UART, so allow for what was on the way.
+static void check_holding(Harness &h, uint32_t ms) {
+  h.run_for(200);
+  uint32_t last = h.printer.get_last_print_time();
+  h.run_for(ms);
+  CHECK_EQ(h.printer.get_last_print_time(), last);
+}
+
+static void run_script() {
+  Harness h;
+  Sensors s;
+  h.display.set_status_interval(500);
+  h.display.set_paper_out_binary_sensor(&s.paper_out);
+  h.display.set_cover_open_binary_sensor(&s.cover_open);
+  h.display.set_overheated_binary_sensor(&s.overheated);
+  h.setup();
+  h.run_for(1000);
+  CHECK(s.paper_out.has_state && !s.paper_out.state);
+  CHECK(s.cover_open.has_state && !s.cover_open.state);
+  CHECK(s.overheated.has_state && !s.overheated.state);
+  CHECK(h.printer.get_status_queries() > 0);
+
+  h.display.enqueue_text(receipt());
+  h.run_for(1000);
+  size_t printed = h.printer.get_text_lines().size();
+  CHECK(printed > 0 && printed < LINES);
+
+  h.printer.set_paper_out(true);
+  h.run_for(1000);
+  CHECK(s.paper_out.state);
+  check_holding(h, 5000);
+
+  h.printer.set_paper_out(false);
+  h.printer.set_cover_open(true);
+  h.run_for(1000);
+  CHECK(!s.paper_out.state);
+  CHECK(s.cover_open.state);
+  check_holding(h, 3000);
+
+  h.printer.set_cover_open(false);
+  h.printer.set_overheated(true);
+  h.run_for(1000);
+  CHECK(!s.cover_open.state);
+  CHECK(s.overheated.state);
+  check_holding(h, 3000);
+
+  h.printer.set_overheated(false);
+  h.run_for(1000);
+  CHECK(!s.overheated.state);
+  CHECK(h.run_until_idle());
+  CHECK_EQ(h.printer.get_text_lines().size(), LINES);
+  CHECK_EQ(h.printer.stats().overrun_bytes, 0);
+}
+
+// Time (ms) until the line after a barcode reaches a printer four times faster than the
+// estimate, polling or not.
+static uint32_t barcode_time(uint32_t status_interval) {
+  Harness h;
+  h.display.set_status_interval(status_interval);
+  h.printer.set_row_time([](uint16_t dots) { return (2100 + (dots + 95) / 96 * 1600) / 4; });
+  h.setup();
+  uint32_t start = millis();
+  h.display.enqueue_barcode("12345678", CODE128);
+  h.display.enqueue_text("Done\n");
+  while (h.printer.get_text_lines().empty()) {
+    CHECK(millis() - start < 600000);
+    h.step();
+  }
+  uint32_t elapsed = millis() - start;
+  CHECK(h.run_until_idle());
+  CHECK_EQ(h.printer.stats().overrun_bytes, 0);
+  return elapsed;
+}
+
+int main() {
+  run_script();
+
+  uint32_t blind = barcode_time(0);
+  uint32_t polled = barcode_time(500);
+  CHECK(polled * 2 < blind);
+  return 0;
+}
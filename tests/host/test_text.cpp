@@ -0,0 +1,77 @@
+// Text jobs reach the paper line by line, wrapped to the paper width, without overrunning the
+// printer's input buffer.
+
+#include "harness.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::thermal_printer;
+
+static std::vector<std::string> words(const std::vector<std::string> &lines) {
+  std::vector<std::string> result;
+  for (auto &line : lines) {
+    std::istringstream stream(line);
+    std::string word;
+    while (stream >> word)
+      result.push_back(word);
+  }
+  return result;
+}
+
+int main() {
+  Harness h;
+  h.setup();
+
+  h.display.print_text("Hello world\nSecond line\n");
+  CHECK(h.run_until_idle());
+  CHECK_EQ(h.printer.get_text_lines().size(), 2);
+  CHECK(h.printer.get_text_lines()[0] == "Hello world");
+  CHECK(h.printer.get_text_lines()[1] == "Second line");
+  CHECK_EQ(h.printer.get_paper_rows(), 2 * 30);
+
+  // Long lines are broken between words at 32 columns
+  h.printer.clear_paper();
+  std::string text;
+  for (int i = 0; i < 8; i++)
+    text += "The quick brown fox jumps over the lazy dog. ";
+  h.display.print_text(text + "\n");
+  CHECK(h.run_until_idle());
+  CHECK(h.printer.get_text_lines().size() > 8);
+  for (auto &line : h.printer.get_text_lines())
+    CHECK(line.size() <= 32);
+  CHECK(words(h.printer.get_text_lines()) == words({text}));
+
+  // A word that ends right at the last column stays on its line
+  h.printer.clear_paper();
+  h.display.print_text(std::string(27, 'a') + " bbbb ccc\n");
+  CHECK(h.run_until_idle());
+  CHECK_EQ(h.printer.get_text_lines().size(), 2);
+  CHECK(h.printer.get_text_lines()[0] == std::string(27, 'a') + " bbbb");
+  CHECK(h.printer.get_text_lines()[1] == "ccc");
+
+  // Double size text wraps at 16 columns and takes twice the height, then the size goes back
+  h.printer.clear_paper();
+  CHECK(h.display.enqueue_text("The quick brown fox jumps\n", 1));
+  CHECK(h.display.enqueue_text("Normal\n"));
+  CHECK(h.run_until_idle());
+  CHECK_EQ(h.printer.get_text_lines().size(), 3);
+  CHECK(h.printer.get_text_lines()[0] == "The quick brown");
+  CHECK(h.printer.get_text_lines()[1] == "fox jumps");
+  CHECK(h.printer.get_text_lines()[2] == "Normal");
+  CHECK_EQ(h.printer.get_paper_rows(), 2 * (2 * 24 + 6) + 30);
+
+  // A long job at 9600 baud is paced to the mechanism, not the UART
+  h.printer.clear_paper();
+  std::string receipt;
+  for (int i = 0; i < 30; i++)
+    receipt += "Line " + std::to_string(i) + " of a long receipt\n";
+  h.display.print_text(receipt);
+  CHECK(h.run_until_idle());
+  CHECK_EQ(h.printer.get_text_lines().size(), 30);
+  CHECK_EQ(h.printer.stats().overrun_bytes, 0);
+  CHECK_EQ(h.printer.get_garbled_bytes(), 0);
+  return 0;
+}
@@ -0,0 +1,40 @@
+// Timing calibration: the timing test page's bands are timed by the printer's GS r replies and the
+// coefficients fitted to them, so raster pacing follows the printer rather than the defaults. Where
+// the UART, not the printer, sets the pace there is nothing to fit and the timing stays as it was.
+
+#include "harness.h"
+
+#include <cstdlib>
+
+using namespace esphome;
+using namespace esphome::thermal_printer;
+
+static const int ROW_TIME = 3000;
+static const int GROUP_TIME = 2400;  // 150% of the default heat time + interval
+
+static void calibrate(uint32_t baud_rate, int expected_row_time, int expected_group_time) {
+  Harness h(baud_rate);
+  h.display.set_height(4 * 48);
+  h.display.set_status_interval(500);
+  h.printer.set_row_time([](uint16_t dots) { return ROW_TIME + (dots + 95) / 96 * GROUP_TIME; });
+  h.setup();
+  h.run_for(1000);
+
+  h.display.calibrate_timing();
+  CHECK(h.run_until_idle());
+  CHECK_EQ(h.printer.get_garbled_bytes(), 0);
+  CHECK_EQ(h.printer.stats().overrun_bytes, 0);
+  CHECK(h.printer.count_dots(0, 0, FakePrinter::PAPER_WIDTH, h.printer.get_paper_rows()) > 0);
+
+  int row_time = h.display.rowTime(0);
+  int group_time = h.display.rowTime(96) - row_time;
+  CHECK(abs(row_time - expected_row_time) <= expected_row_time / 20);
+  CHECK(abs(group_time - expected_group_time) <= expected_group_time / 20);
+}
+
+int main() {
+  calibrate(115200, ROW_TIME, GROUP_TIME);
+  // A row takes longer to arrive at 9600 baud than to print, so the defaults stay
+  calibrate(9600, 2100, 1600);
+  return 0;
+}